@@ -0,0 +1,161 @@
+// Replays a Studio command capture (see fmod.startCommandCapture) without a
+// sound device and reports how long each update took. Everything runs from
+// update on this thread, so the numbers are the cost of the captured audio
+// workload on its own.
+//
+// Usage: replaybench <capture> [-b bankPath] [-n dspBufferLength] [-r sampleRate]
+
+#include "fmod_studio.hpp"
+#include "fmod.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+static bool Check(FMOD_RESULT result, const char* what)
+{
+	if (result != FMOD_OK)
+	{
+		std::fprintf(stderr, "%s failed (FMOD error %d)\n", what, static_cast<int>(result));
+		return false;
+	}
+
+	return true;
+}
+
+static double Percentile(const std::vector<double>& sorted, double fraction)
+{
+	if (sorted.empty())
+	{
+		return 0.0;
+	}
+
+	std::size_t rank = static_cast<std::size_t>(fraction * (sorted.size() - 1) + 0.5);
+	return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+int main(int argc, char** argv)
+{
+	const char* capturePath = nullptr;
+	const char* bankPath = nullptr;
+	unsigned int bufferLength = 1024;
+	int sampleRate = 48000;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+		{
+			bankPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+		{
+			bufferLength = static_cast<unsigned int>(std::atoi(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+		{
+			sampleRate = std::atoi(argv[++i]);
+		}
+		else
+		{
+			capturePath = argv[i];
+		}
+	}
+
+	if (!capturePath || bufferLength == 0 || sampleRate <= 0)
+	{
+		std::fprintf(stderr, "usage: %s <capture> [-b bankPath] [-n dspBufferLength] [-r sampleRate]\n", argv[0]);
+		return 2;
+	}
+
+	FMOD::Studio::System* studioSystem = nullptr;
+	FMOD::System* coreSystem = nullptr;
+
+	if (!Check(FMOD::Studio::System::create(&studioSystem), "System::create") ||
+		!Check(studioSystem->getCoreSystem(&coreSystem), "getCoreSystem") ||
+		!Check(coreSystem->setOutput(FMOD_OUTPUTTYPE_NOSOUND_NRT), "setOutput") ||
+		!Check(coreSystem->setDSPBufferSize(bufferLength, 4), "setDSPBufferSize") ||
+		!Check(coreSystem->setSoftwareFormat(sampleRate, FMOD_SPEAKERMODE_DEFAULT, 0), "setSoftwareFormat") ||
+		!Check(studioSystem->initialize(1024, FMOD_STUDIO_INIT_SYNCHRONOUS_UPDATE | FMOD_STUDIO_INIT_LOAD_FROM_UPDATE,
+			FMOD_INIT_STREAM_FROM_UPDATE | FMOD_INIT_MIX_FROM_UPDATE, nullptr), "initialize"))
+	{
+		return 1;
+	}
+
+	// The replay loads the captured banks itself, from bankPath if given.
+	// Fast forward runs the commands without waiting for their captured
+	// timestamps, so each update mixes one block as soon as the last is done.
+	FMOD::Studio::CommandReplay* replay = nullptr;
+
+	if (!Check(studioSystem->loadCommandReplay(capturePath, FMOD_STUDIO_COMMANDREPLAY_FAST_FORWARD, &replay),
+		"loadCommandReplay") ||
+		(bankPath && !Check(replay->setBankPath(bankPath), "setBankPath")) ||
+		!Check(replay->start(), "CommandReplay::start"))
+	{
+		return 1;
+	}
+
+	std::vector<double> updateMs;
+	double dspUsage = 0.0, studioUsage = 0.0;
+
+	std::clock_t cpuStart = std::clock();
+	auto wallStart = std::chrono::steady_clock::now();
+
+	for (;;)
+	{
+		auto start = std::chrono::steady_clock::now();
+		FMOD_RESULT result = studioSystem->update();
+		auto end = std::chrono::steady_clock::now();
+
+		if (!Check(result, "update"))
+		{
+			break;
+		}
+
+		updateMs.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+
+		FMOD_STUDIO_CPU_USAGE cpu = {};
+		studioSystem->getCPUUsage(&cpu);
+		dspUsage += cpu.dspusage;
+		studioUsage += cpu.studiousage;
+
+		FMOD_STUDIO_PLAYBACK_STATE state = FMOD_STUDIO_PLAYBACK_STOPPED;
+		replay->getPlaybackState(&state);
+
+		if (state == FMOD_STUDIO_PLAYBACK_STOPPED)
+		{
+			break;
+		}
+	}
+
+	double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+	double cpuSeconds = static_cast<double>(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+
+	int currentBytes = 0, peakBytes = 0;
+	FMOD::Memory_GetStats(&currentBytes, &peakBytes, true);
+
+	replay->release();
+	studioSystem->release();
+
+	std::size_t frames = updateMs.size();
+	double audioSeconds = static_cast<double>(frames) * bufferLength / sampleRate;
+	std::vector<double> sorted = updateMs;
+	std::sort(sorted.begin(), sorted.end());
+
+	std::printf("updates       %zu\n", frames);
+	std::printf("audio         %.2f s\n", audioSeconds);
+	std::printf("wall          %.2f s (%.1fx realtime)\n", wallSeconds,
+		wallSeconds > 0.0 ? audioSeconds / wallSeconds : 0.0);
+	std::printf("update p50    %.3f ms\n", Percentile(sorted, 0.5));
+	std::printf("update p95    %.3f ms\n", Percentile(sorted, 0.95));
+	std::printf("update p99    %.3f ms\n", Percentile(sorted, 0.99));
+	std::printf("update max    %.3f ms\n", sorted.empty() ? 0.0 : sorted.back());
+	std::printf("process cpu   %.2f s\n", cpuSeconds);
+	std::printf("fmod cpu      dsp %.2f%%, studio %.2f%% (mean)\n", frames ? dspUsage / frames : 0.0,
+		frames ? studioUsage / frames : 0.0);
+	std::printf("peak memory   %.2f MB (FMOD heap)\n", peakBytes / (1024.0 * 1024.0));
+
+	return 0;
+}
@@ -0,0 +1,228 @@
+-- Loads fmod-love and, when running on LuaJIT, rebinds the hot path functions
+-- to the library's C exports so calls can be compiled by the JIT instead of
+-- going through the Lua C API. Use it in place of the native module:
+--
+--     fmod = require("fmod")
+--
+-- Every function keeps the signature and return values documented in the
+-- README. Unlike the native module, the FFI bound functions don't treat a
+-- missing number argument as 0, so pass every argument explicitly.
+
+-- MSVC builds export luaopen_fmodlove from fmodlove.dll, every other build
+-- exports luaopen_libfmodlove from libfmodlove. Plain Lua has no jit table,
+-- so Windows is recognised by its directory separator, and the other name is
+-- tried if the expected one can't be loaded.
+local isWindows = package.config:sub(1, 1) == "\\"
+local libraryName = isWindows and "fmodlove" or "libfmodlove"
+
+local found, native = pcall(require, libraryName)
+if not found then
+	libraryName = isWindows and "libfmodlove" or "fmodlove"
+	native = require(libraryName)
+end
+
+local fmod = {}
+for name, func in pairs(native) do
+	fmod[name] = func
+end
+
+-- Functions rebound to the C exports below, by name. Profiling has to go
+-- through the native module, so while it is on they are swapped back to the
+-- native functions, and the FFI bound ones are restored when it is turned off.
+-- The batch functions that accept FFI arrays stay in place and look up the
+-- native function on every call, so only their FFI array form is not timed.
+local ffiBound = {}
+local dispatching = {
+	setParametersByIDs = true, setGlobalParametersByIDs = true, set3DAttributesBatch = true,
+	getMeterLevels = true, getSpectrum = true, getBusVolumes = true, setBusVolumes = true,
+	setEmitterPositions = true,
+}
+
+fmod.setProfiling = function(enabled)
+	native.setProfiling(enabled)
+	for name, func in pairs(native) do
+		if name ~= "setProfiling" and not dispatching[name] then
+			fmod[name] = (not enabled and ffiBound[name]) or func
+		end
+	end
+end
+
+local hasFFI, ffi = pcall(require, "ffi")
+if not hasFFI then
+	return fmod
+end
+
+ffi.cdef[[
+	bool fmodlove_update(void);
+	bool fmodlove_set_listener_3d_position(unsigned int listener, float posX, float posY, float posZ, float dirX, float dirY, float dirZ, float oX, float oY, float oZ);
+	int fmodlove_create_instance(const char* eventPath, bool autoRelease);
+	bool fmodlove_start_instance(unsigned int index);
+	bool fmodlove_stop_instance(unsigned int index, int stopMode);
+	bool fmodlove_release_instance(unsigned int index);
+	bool fmodlove_set_3d_attributes(unsigned int index, float posX, float posY, float posZ, float dirX, float dirY, float dirZ, float oX, float oY, float oZ);
+	int fmodlove_set_3d_attributes_batch(const unsigned int* indices, int count, const float* positions, const float* forwards, const float* ups, const float* velocities);
+	int fmodlove_get_meter_levels(const unsigned int* meters, float* levels, int count);
+	int fmodlove_get_spectrum(unsigned int spectrum, float* bands, int count);
+	int fmodlove_set_emitter_positions(const unsigned int* emitters, int count, const float* positions);
+	bool fmodlove_play_one_shot_2d(const char* eventPath);
+	bool fmodlove_play_one_shot_3d(const char* eventPath, float posX, float posY, float posZ, float dirX, float dirY, float dirZ, float oX, float oY, float oZ);
+	bool fmodlove_set_instance_volume(unsigned int index, float volume);
+	bool fmodlove_is_playing(unsigned int index);
+	bool fmodlove_set_instance_paused(unsigned int index, bool pause);
+	bool fmodlove_set_instance_pitch(unsigned int index, float pitch);
+	float fmodlove_get_instance_pitch(unsigned int index);
+	int fmodlove_get_timeline_position(unsigned int index);
+	bool fmodlove_set_timeline_position(unsigned int index, unsigned int position);
+	float fmodlove_get_global_parameter_by_name(const char* parameterName);
+	bool fmodlove_set_global_parameter_by_name(const char* parameterName, float value, bool ignoreSeekSpeed);
+	float fmodlove_get_parameter_by_name(unsigned int index, const char* parameterName);
+	bool fmodlove_set_parameter_by_name(unsigned int index, const char* parameterName, float value, bool ignoreSeekSpeed);
+	float fmodlove_get_parameter_by_id(unsigned int index, unsigned int parameterId);
+	bool fmodlove_set_parameter_by_id(unsigned int index, unsigned int parameterId, float value, bool ignoreSeekSpeed);
+	bool fmodlove_set_parameters_by_ids(unsigned int index, const unsigned int* parameterIds, float* values, int count, bool ignoreSeekSpeed);
+	float fmodlove_get_global_parameter_by_id(unsigned int parameterId);
+	bool fmodlove_set_global_parameter_by_id(unsigned int parameterId, float value, bool ignoreSeekSpeed);
+	bool fmodlove_set_global_parameters_by_ids(const unsigned int* parameterIds, float* values, int count, bool ignoreSeekSpeed);
+	float fmodlove_get_bus_volume(unsigned int index);
+	bool fmodlove_set_bus_volume(unsigned int index, float volume);
+	int fmodlove_get_bus_volumes(const unsigned int* indices, float* volumes, int count);
+	int fmodlove_set_bus_volumes(const unsigned int* indices, const float* volumes, int count);
+	float fmodlove_get_vca_volume(unsigned int index);
+	bool fmodlove_set_vca_volume(unsigned int index, float volume);
+]]
+
+local libraryPath = package.searchpath and package.searchpath(libraryName, package.cpath)
+local loaded, C = pcall(ffi.load, libraryPath or libraryName)
+if not loaded then
+	return fmod
+end
+
+fmod.update = C.fmodlove_update
+fmod.setListener3DPosition = C.fmodlove_set_listener_3d_position
+fmod.startInstance = C.fmodlove_start_instance
+fmod.stopInstance = C.fmodlove_stop_instance
+fmod.releaseInstance = C.fmodlove_release_instance
+fmod.set3DAttributes = C.fmodlove_set_3d_attributes
+fmod.playOneShot2D = C.fmodlove_play_one_shot_2d
+fmod.playOneShot3D = C.fmodlove_play_one_shot_3d
+fmod.setInstanceVolume = C.fmodlove_set_instance_volume
+fmod.isPlaying = C.fmodlove_is_playing
+fmod.setInstancePitch = C.fmodlove_set_instance_pitch
+fmod.getInstancePitch = C.fmodlove_get_instance_pitch
+fmod.getTimelinePosition = C.fmodlove_get_timeline_position
+fmod.setTimelinePosition = C.fmodlove_set_timeline_position
+fmod.getGlobalParameterByName = C.fmodlove_get_global_parameter_by_name
+fmod.getParameterByName = C.fmodlove_get_parameter_by_name
+fmod.getParameterByID = C.fmodlove_get_parameter_by_id
+fmod.getGlobalParameterByID = C.fmodlove_get_global_parameter_by_id
+fmod.getBusVolume = C.fmodlove_get_bus_volume
+fmod.setBusVolume = C.fmodlove_set_bus_volume
+fmod.getVCAVolume = C.fmodlove_get_vca_volume
+fmod.setVCAVolume = C.fmodlove_set_vca_volume
+
+-- The FFI won't convert nil to bool, while the native module treats a missing
+-- flag as false, so the functions taking a trailing flag are wrapped.
+local fmodlove_create_instance = C.fmodlove_create_instance
+function fmod.createInstance(eventPath, autoRelease)
+	return fmodlove_create_instance(eventPath, autoRelease == true)
+end
+
+local fmodlove_set_instance_paused = C.fmodlove_set_instance_paused
+function fmod.setInstancePaused(index, pause)
+	return fmodlove_set_instance_paused(index, pause == true)
+end
+
+local fmodlove_set_global_parameter_by_name = C.fmodlove_set_global_parameter_by_name
+function fmod.setGlobalParameterByName(name, value, ignoreSeekSpeed)
+	return fmodlove_set_global_parameter_by_name(name, value, ignoreSeekSpeed == true)
+end
+
+local fmodlove_set_parameter_by_name = C.fmodlove_set_parameter_by_name
+function fmod.setParameterByName(index, name, value, ignoreSeekSpeed)
+	return fmodlove_set_parameter_by_name(index, name, value, ignoreSeekSpeed == true)
+end
+
+local fmodlove_set_parameter_by_id = C.fmodlove_set_parameter_by_id
+function fmod.setParameterByID(index, parameterId, value, ignoreSeekSpeed)
+	return fmodlove_set_parameter_by_id(index, parameterId, value, ignoreSeekSpeed == true)
+end
+
+local fmodlove_set_global_parameter_by_id = C.fmodlove_set_global_parameter_by_id
+function fmod.setGlobalParameterByID(parameterId, value, ignoreSeekSpeed)
+	return fmodlove_set_global_parameter_by_id(parameterId, value, ignoreSeekSpeed == true)
+end
+
+-- The multi-parameter and batch setters take Lua tables or pointers in the
+-- native module. FFI arrays (or ByteData:getFFIPointer()) are handed to the C
+-- exports directly; anything else still goes through the native function.
+local fmodlove_set_parameters_by_ids = C.fmodlove_set_parameters_by_ids
+function fmod.setParametersByIDs(index, parameterIds, values, ignoreSeekSpeed, count)
+	if type(parameterIds) == "cdata" then
+		return fmodlove_set_parameters_by_ids(index, parameterIds, values, count, ignoreSeekSpeed == true)
+	end
+	return native.setParametersByIDs(index, parameterIds, values, ignoreSeekSpeed)
+end
+
+local fmodlove_set_global_parameters_by_ids = C.fmodlove_set_global_parameters_by_ids
+function fmod.setGlobalParametersByIDs(parameterIds, values, ignoreSeekSpeed, count)
+	if type(parameterIds) == "cdata" then
+		return fmodlove_set_global_parameters_by_ids(parameterIds, values, count, ignoreSeekSpeed == true)
+	end
+	return native.setGlobalParametersByIDs(parameterIds, values, ignoreSeekSpeed)
+end
+
+local fmodlove_set_3d_attributes_batch = C.fmodlove_set_3d_attributes_batch
+function fmod.set3DAttributesBatch(indices, positions, forwards, ups, velocities, count)
+	if type(indices) == "cdata" then
+		return fmodlove_set_3d_attributes_batch(indices, count, positions, forwards, ups, velocities)
+	end
+	return native.set3DAttributesBatch(indices, positions, forwards, ups, velocities, count)
+end
+
+local fmodlove_get_meter_levels = C.fmodlove_get_meter_levels
+function fmod.getMeterLevels(meters, levels, count)
+	if type(meters) == "cdata" then
+		return fmodlove_get_meter_levels(meters, levels, count)
+	end
+	return native.getMeterLevels(meters, levels, count)
+end
+
+local fmodlove_get_spectrum = C.fmodlove_get_spectrum
+function fmod.getSpectrum(spectrum, bands, count)
+	if type(bands) == "cdata" then
+		return fmodlove_get_spectrum(spectrum, bands, count)
+	end
+	return native.getSpectrum(spectrum, bands, count)
+end
+
+local fmodlove_get_bus_volumes = C.fmodlove_get_bus_volumes
+function fmod.getBusVolumes(indices, volumes, count)
+	if type(indices) == "cdata" then
+		return fmodlove_get_bus_volumes(indices, volumes, count)
+	end
+	return native.getBusVolumes(indices, volumes, count)
+end
+
+local fmodlove_set_bus_volumes = C.fmodlove_set_bus_volumes
+function fmod.setBusVolumes(indices, volumes, count)
+	if type(indices) == "cdata" then
+		return fmodlove_set_bus_volumes(indices, volumes, count)
+	end
+	return native.setBusVolumes(indices, volumes, count)
+end
+
+local fmodlove_set_emitter_positions = C.fmodlove_set_emitter_positions
+function fmod.setEmitterPositions(emitters, positions, count)
+	if type(emitters) == "cdata" then
+		return fmodlove_set_emitter_positions(emitters, count, positions)
+	end
+	return native.setEmitterPositions(emitters, positions, count)
+end
+
+for name, func in pairs(fmod) do
+	if name ~= "setProfiling" and not dispatching[name] and func ~= native[name] then
+		ffiBound[name] = func
+	end
+end
+
+return fmod
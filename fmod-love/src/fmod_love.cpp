@@ -1,24 +1,90 @@
 #include "fmod_love.h"
 
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 FMOD::Studio::System* studioSystem = nullptr;
 FMOD::System* coreSystem = nullptr;
 
-std::unordered_map<std::size_t, FMOD::Studio::EventInstance*> instanceList;
-std::size_t nInstances = 0;
+HandleTable<FMOD::Studio::EventInstance> instanceList;
+
+HandleTable<FMOD::Studio::Bank> bankList;
+
+HandleTable<FMOD::Studio::Bus> busList;
+
+HandleTable<FMOD::Studio::VCA> vcaList;
+
+// Listeners as last set. Their attributes are sent to FMOD from Update().
+Listener listenerStates[MaxListeners] = {};
+int numListeners = 1;
+
+// Instances flagged for auto release, mapped to whether they have been started
+// yet. Update() releases started ones once they reach STOPPED.
+std::unordered_map<unsigned int, bool> autoReleaseInstances;
+long long reapedInstances = 0;
+
+// Busses and VCAs are interned, so looking up the same one again, by path or
+// by GUID, returns the handle it already has.
+MixerLookup busLookup;
+MixerLookup vcaLookup;
+
+// Parameter IDs are interned into a flat array so Lua only ever holds a small
+// integer instead of the 64 bit FMOD_STUDIO_PARAMETER_ID, which a Lua number
+// can't represent exactly.
+std::vector<FMOD_STUDIO_PARAMETER_ID> parameterIdList;
+std::unordered_map<std::uint64_t, int> parameterIdLookup;
 
-std::unordered_map<std::size_t, FMOD::Studio::Bank*> bankList;
-std::size_t nBanks = 0;
+// FMOD rejects setParametersByIDs calls with more than this many parameters.
+const int MaxParametersPerCall = 32;
 
-std::unordered_map<std::size_t, FMOD::Studio::Bus*> busList;
-std::size_t nBusses = 0;
+struct CachedEvent {
+	std::string path;
+	EventInfo info;
+};
+
+std::vector<MappedBank> mappedBanks;
+
+std::vector<PendingBankLoad> pendingBankLoads;
+std::vector<BankLoadEvent> bankLoadEvents;
+
+// Number of async loads queued and finished since the queue was last empty,
+// for the aggregate progress.
+int asyncBankLoadsQueued = 0;
+int asyncBankLoadsFinished = 0;
+
+// One-shot policies keyed by event path. They outlive the event cache, which
+// is flushed whenever a bank is unloaded, and are linked into EventInfo when an
+// event is resolved.
+std::unordered_map<std::string, OneShotPolicy> oneShotPolicies;
+
+// Owns every resolved event, keyed by a view into the entry's own path string
+// so lookups never have to allocate.
+std::unordered_map<std::string_view, std::unique_ptr<CachedEvent>> eventCache;
+
+// Lua interns its strings, so the same event path passed from Lua nearly always
+// arrives at the same address. This direct mapped table short-circuits the hash
+// lookup on that pointer; the path compare guards against a collected string
+// whose address was reused.
+struct EventPointerSlot {
+	const char* key;
+	CachedEvent* entry;
+};
 
-std::unordered_map<std::size_t, FMOD::Studio::VCA*> vcaList;
-std::size_t nVCAs = 0;
+const std::size_t EventPointerCacheSize = 256;
+EventPointerSlot eventPointerCache[EventPointerCacheSize] = {};
 
 
 void To3DAttributes(Vector3 position, Vector3 forward, Vector3 up, FMOD_3D_ATTRIBUTES& outAttributes)
 {
-	FMOD_3D_ATTRIBUTES attributes;
+	FMOD_3D_ATTRIBUTES attributes = {};
 
 	attributes.forward;		ToFMODVector(forward, attributes.forward);
 	attributes.up;			ToFMODVector(up, attributes.up);
@@ -40,10 +106,36 @@ static int LuaIntDefault(lua_State* L, int i, int def)
 	return (lua_gettop(L) >= i && !lua_isnil(L, i)) ? luaL_checkint(L, i) : def;
 }
 
+static float LuaNumberDefault(lua_State* L, int i, float def)
+{
+	return lua_isnoneornil(L, i) ? def : static_cast<float>(lua_tonumber(L, i));
+}
+
+// Number of failures per FMOD_RESULT seen by CheckError. Event callbacks
+// check errors too, so these are also written from FMOD's threads.
+const int ResultCounterCount = 128;
+std::atomic<long long> resultCounters[ResultCounterCount] = {};
+
+// One entry per function in love_fmod_methods, in the same order. While
+// profiling is on, the module's functions are replaced by closures over their
+// index, see love_fmod_profiled_call.
+std::vector<BindingStats> bindingStats;
+bool profilingEnabled = false;
+
+// Registry reference to the module table, so its functions can be swapped
+// when profiling is turned on or off.
+int moduleReference = LUA_NOREF;
+
 static bool CheckError(const FMOD_RESULT result)
 {
 	if (result != FMOD_OK)
 	{
+		int code = static_cast<int>(result);
+		if (code >= 0 && code < ResultCounterCount)
+		{
+			resultCounters[code].fetch_add(1, std::memory_order_relaxed);
+		}
+
 		return false;
 	}
 
@@ -52,917 +144,6534 @@ static bool CheckError(const FMOD_RESULT result)
 
 #define ERROR_CHECK(result) CheckError(result)
 
-bool Init(const unsigned int& outputType, const unsigned int& realChannels, const unsigned int& virtualChannels,
-	const unsigned int& studioInitFlags)
+static bool InstanceIsPlaying(FMOD::Studio::EventInstance* instance);
+
+static float InstanceRMS(FMOD::Studio::EventInstance* instance);
+
+static std::size_t EventPointerSlotIndex(const char* eventPath)
 {
-	auto result = FMOD::Studio::System::create(&studioSystem);
+	return (reinterpret_cast<std::uintptr_t>(eventPath) >> 4) & (EventPointerCacheSize - 1);
+}
 
-	if (result != FMOD_OK) {
-		return false;
+const EventInfo* GetEventInfo(const char* eventPath)
+{
+	if (!eventPath || !studioSystem)
+	{
+		return nullptr;
 	}
 
-	result = studioSystem->getCoreSystem(&coreSystem);
+	EventPointerSlot& slot = eventPointerCache[EventPointerSlotIndex(eventPath)];
 
-	if (result != FMOD_OK) {
-		return false;
+	if (slot.key == eventPath && slot.entry->path == eventPath)
+	{
+		return &slot.entry->info;
 	}
 
-	result = coreSystem->setOutput((FMOD_OUTPUTTYPE)outputType);
+	auto cached = eventCache.find(std::string_view(eventPath));
 
-	if (result != FMOD_OK) {
-		return false;
-	}
+	if (cached == eventCache.end())
+	{
+		FMOD::Studio::EventDescription* eventDescription = nullptr;
+		auto result = studioSystem->getEvent(eventPath, &eventDescription);
 
-	result = coreSystem->setSoftwareChannels(realChannels);
+		if (result != FMOD_OK || !eventDescription)
+		{
+			return nullptr;
+		}
 
-	if (result != FMOD_OK) {
-		return false;
-	}
+		auto entry = std::make_unique<CachedEvent>();
+		entry->path = eventPath;
 
-	result = studioSystem->initialize(virtualChannels,
-		(FMOD_STUDIO_INITFLAGS)studioInitFlags,
-		FMOD_INIT_NORMAL, NULL);
+		EventInfo& info = entry->info;
+		info.description = eventDescription;
 
-	if (result != FMOD_OK) 
-	{
-		return false;
+		auto policy = oneShotPolicies.find(entry->path);
+		info.policy = policy != oneShotPolicies.end() ? &policy->second : nullptr;
+		info.is3D = false;
+		info.isOneshot = false;
+		info.minDistance = 0.f;
+		info.maxDistance = 0.f;
+		info.length = 0;
+
+		eventDescription->is3D(&info.is3D);
+		eventDescription->isOneshot(&info.isOneshot);
+		eventDescription->getMinMaxDistance(&info.minDistance, &info.maxDistance);
+		eventDescription->getLength(&info.length);
+
+		std::string_view key = entry->path;
+		cached = eventCache.emplace(key, std::move(entry)).first;
 	}
 
-	return 1;
-}
+	slot.key = eventPath;
+	slot.entry = cached->second.get();
 
-bool Update()
-{
-	auto result = studioSystem->update();
-	return ERROR_CHECK(result);
+	return &slot.entry->info;
 }
 
-int LoadBank(const char* bankPath, int flags)
+void ClearEventCache()
 {
-	FMOD::Studio::Bank* bank;
-	auto result = studioSystem->loadBankFile(
-		bankPath, (FMOD_STUDIO_LOAD_BANK_FLAGS)flags, &bank);
-
-	if (!ERROR_CHECK(result)) 
+	for (auto& slot : eventPointerCache)
 	{
-		return -1;
+		slot.key = nullptr;
+		slot.entry = nullptr;
 	}
 
-	if (bank) 
-	{
-		bankList.emplace(nBanks++, bank);
-		return static_cast<int>(nBanks - 1);
-	}
-	else
-		return -1;
+	eventCache.clear();
 }
 
-bool UnloadBank(const unsigned int& index)
-{
-	std::size_t i = (std::size_t)round(index);
+// Deferred mode. Setters record a DeferredCommand instead of calling into
+// Studio, and FlushDeferredCommands() replays the buffer in one loop right
+// before studioSystem->update(). A later write to the same field of the same
+// target overwrites the recorded value in place, so only the last one reaches
+// FMOD. Only the Lua thread touches the buffer, so it needs no locking.
+struct DeferredKey {
+	void* target;
+	std::uint64_t parameter;
+	int field;
+
+	bool operator==(const DeferredKey& other) const
+	{
+		return target == other.target && parameter == other.parameter && field == other.field;
+	}
+};
 
-	if (bankList.count(i) == 0) 
+struct DeferredKeyHash {
+	std::size_t operator()(const DeferredKey& key) const
 	{
-		return false;
+		std::size_t hash = std::hash<void*>()(key.target);
+		hash ^= std::hash<std::uint64_t>()(key.parameter) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+		hash ^= static_cast<std::size_t>(key.field) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+		return hash;
 	}
+};
 
-	auto result = bankList[i]->unload();
+bool deferredMode = false;
+std::vector<DeferredCommand> deferredCommands;
+std::vector<FMOD_3D_ATTRIBUTES> deferredAttributes;
+std::unordered_map<DeferredKey, std::size_t, DeferredKeyHash> deferredLookup;
+long long deferredRecorded = 0;
+long long deferredMerged = 0;
 
-	return ERROR_CHECK(result);
-}
+// Instance objects collected while they still had recorded setters. They are
+// released by the next flush, right after those setters are applied.
+std::vector<FMOD::Studio::EventInstance*> deferredReleases;
 
-bool SetNumListeners(const unsigned int& listeners)
-{
-	auto result = studioSystem->setNumListeners(listeners);
+static void ForgetSetterShadow(void* target);
 
-	return ERROR_CHECK(result);
+static std::uint64_t PackParameterID(const FMOD_STUDIO_PARAMETER_ID& id)
+{
+	return (static_cast<std::uint64_t>(id.data1) << 32) | id.data2;
 }
 
-bool SetListener3DPosition(const unsigned int& listener, float posX, float posY, float posZ,
-	float dirX, float dirY, float dirZ, float oX,
-	float oY, float oZ)
+static FMOD_STUDIO_PARAMETER_ID UnpackParameterID(std::uint64_t packed)
 {
-	Vector3 pos = Vector3(posX, posY, posZ);
-	Vector3 forward = Vector3(dirX, dirY, dirZ);
-	Vector3 up = Vector3(oX, oY, oZ);
-
-	FMOD_3D_ATTRIBUTES attributes; To3DAttributes(pos, forward, up, attributes);
-
-	auto result = studioSystem->setListenerAttributes(listener, &attributes);
-
-	return ERROR_CHECK(result);
+	FMOD_STUDIO_PARAMETER_ID id;
+	id.data1 = static_cast<unsigned int>(packed >> 32);
+	id.data2 = static_cast<unsigned int>(packed);
+	return id;
 }
 
-int CreateInstance(const char* eventPath)
+static void DeferCommand(void* target, DeferredField field, std::uint64_t parameter, float value, bool flag,
+	const FMOD_3D_ATTRIBUTES* attributes = nullptr)
 {
-	FMOD::Studio::EventDescription* eventDescription = nullptr;
-	auto result = studioSystem->getEvent(eventPath, &eventDescription);
+	deferredRecorded++;
 
-	if (result != FMOD_OK) {
-		return -1;
-	}
+	DeferredKey key = { target, parameter, field };
+	auto found = deferredLookup.find(key);
 
-	if (eventDescription) 
+	if (found != deferredLookup.end())
 	{
-		FMOD::Studio::EventInstance* eventInstance = nullptr;
-		auto result = eventDescription->createInstance(&eventInstance);
-		if (result == FMOD_OK) 
+		DeferredCommand& command = deferredCommands[found->second];
+		command.value = value;
+		command.flag = flag;
+		if (attributes)
 		{
-			instanceList.emplace(nInstances++, eventInstance);
-			return static_cast<int>(nInstances - 1);
+			deferredAttributes[command.attributes] = *attributes;
 		}
-		else
-		{
-			return -1;
-		}		
-	}
-	else 
-	{
-		return -1;
-	}		
-}
-
-bool StartInstance(const unsigned int& index)
-{
-	std::size_t i = (std::size_t)round(index);
-
-	if (instanceList.count(i) == 0) {
-		return false;
+		deferredMerged++;
+		return;
 	}
-	auto result = instanceList[i]->start();
-
-	return ERROR_CHECK(result);
-}
 
-bool StopInstance(const unsigned int& index, int stopMode)
-{
-	std::size_t i = (std::size_t)round(index);
+	DeferredCommand command = { target, parameter, field, flag, value, 0 };
 
-	if (instanceList.count(i) == 1) 
+	if (attributes)
 	{
-		auto result = instanceList[i]->stop((FMOD_STUDIO_STOP_MODE)(stopMode));
-
-		return ERROR_CHECK(result);
+		command.attributes = static_cast<unsigned int>(deferredAttributes.size());
+		deferredAttributes.push_back(*attributes);
 	}
 
-	return false;
+	deferredLookup.emplace(key, deferredCommands.size());
+	deferredCommands.push_back(command);
 }
 
-bool ReleaseInstance(const unsigned int& index)
+void FlushDeferredCommands()
 {
-	std::size_t i = (std::size_t)round(index);
-
-	if (instanceList.count(i) == 1) 
+	for (const auto& command : deferredCommands)
 	{
-		auto result = instanceList[i]->release();
+		auto instance = static_cast<FMOD::Studio::EventInstance*>(command.target);
+		FMOD_RESULT result = FMOD_OK;
 
-		if (result != FMOD_OK) 
+		switch (command.field)
 		{
-			return false;
+		case DEFERRED_INSTANCE_VOLUME:
+			result = instance->setVolume(command.value);
+			break;
+		case DEFERRED_INSTANCE_PITCH:
+			result = instance->setPitch(command.value);
+			break;
+		case DEFERRED_INSTANCE_PAUSED:
+			result = instance->setPaused(command.flag);
+			break;
+		case DEFERRED_INSTANCE_TIMELINE_POSITION:
+			result = instance->setTimelinePosition(static_cast<int>(command.value));
+			break;
+		case DEFERRED_INSTANCE_3D_ATTRIBUTES:
+			result = instance->set3DAttributes(&deferredAttributes[command.attributes]);
+			break;
+		case DEFERRED_INSTANCE_PARAMETER:
+			result = instance->setParameterByID(UnpackParameterID(command.parameter), command.value, command.flag);
+			break;
+		case DEFERRED_GLOBAL_PARAMETER:
+			result = studioSystem->setParameterByID(UnpackParameterID(command.parameter), command.value, command.flag);
+			break;
+		case DEFERRED_BUS_VOLUME:
+			result = static_cast<FMOD::Studio::Bus*>(command.target)->setVolume(command.value);
+			break;
+		case DEFERRED_VCA_VOLUME:
+			result = static_cast<FMOD::Studio::VCA*>(command.target)->setVolume(command.value);
+			break;
 		}
 
-		instanceList.erase(i);
+		ERROR_CHECK(result);
 	}
 
-	return true;
-}
-
-bool Set3DAttributes(const unsigned int& index, float posX, float posY, float posZ, float dirX,
-	float dirY, float dirZ, float oX, float oY, float oZ)
-{
-	std::size_t i = (std::size_t)round(index);
+	deferredCommands.clear();
+	deferredAttributes.clear();
+	deferredLookup.clear();
 
-	if (instanceList.count(i) == 0) 
+	for (auto instance : deferredReleases)
 	{
-		return false;
+		instance->release();
+		ForgetSetterShadow(instance);
 	}
 
-	Vector3 pos = { posX, posY, posZ };
-	Vector3 forward = { dirX, dirY, dirZ };
-	Vector3 up = { oX, oY, oZ };
-
-	FMOD_3D_ATTRIBUTES attributes; To3DAttributes(pos, forward, up, attributes);
+	deferredReleases.clear();
+}
 
-	auto result = instanceList[i]->set3DAttributes(&attributes);
+void SetDeferredMode(bool enabled)
+{
+	if (!enabled)
+	{
+		FlushDeferredCommands();
+	}
 
-	return ERROR_CHECK(result);
+	deferredMode = enabled;
 }
 
-bool PlayOneShot2D(const char* eventPath)
+// Dirty tracking. Every setter goes through one of the Apply* functions below,
+// which drop the write when it is within the field's epsilon of the last value
+// written to the same target, then either record it for deferred mode or call
+// FMOD. Shadows of released instances are forgotten so a new instance that
+// FMOD happens to give the same handle doesn't inherit them.
+bool dirtyTracking = false;
+std::unordered_map<void*, SetterShadow> setterShadows;
+float dirtyEpsilons[DIRTY_EPSILON_COUNT] = { 1e-3f, 1e-3f, 1e-4f, 1e-3f, 1e-3f, 1e-4f };
+long long suppressedSetters = 0;
+
+void SetDirtyTracking(bool enabled)
 {
-	FMOD::Studio::EventDescription* eventDescription = NULL;
-	auto result = studioSystem->getEvent(eventPath, &eventDescription);
+	dirtyTracking = enabled;
+	setterShadows.clear();
+}
 
-	if (result != FMOD_OK) 
+void SetDirtyEpsilon(DirtyEpsilon field, float epsilon)
+{
+	if (field >= 0 && field < DIRTY_EPSILON_COUNT)
 	{
-		return false;
+		dirtyEpsilons[field] = std::max(epsilon, 0.f);
 	}
+}
 
-	if (eventDescription) 
+static void ForgetSetterShadow(void* target)
+{
+	if (!setterShadows.empty())
 	{
-		FMOD::Studio::EventInstance* eventInstance = NULL;
-		auto result = eventDescription->createInstance(&eventInstance);
-
-		if (eventInstance) 
-		{
-			eventInstance->start();
-			eventInstance->release();
-			return true;
-		}
-		else
-			return false;
+		setterShadows.erase(target);
 	}
-	else
-		return false;
 }
 
-bool PlayOneShot3D(const char* eventPath, float posX, float posY, float posZ,
-	float dirX, float dirY, float dirZ, float oX, float oY,
-	float oZ)
+static SetterShadow& GetSetterShadow(void* target)
 {
-	FMOD::Studio::EventDescription* eventDescription = NULL;
-	auto result = studioSystem->getEvent(eventPath, &eventDescription);
-
-	if (result != FMOD_OK) {
-		return false;
-	}
+	auto found = setterShadows.find(target);
 
-	if (eventDescription) 
+	if (found != setterShadows.end())
 	{
-		bool is3D;
-		eventDescription->is3D(&is3D);
-
-		if (!is3D) {
-			return false;
-		}
-
-		FMOD::Studio::EventInstance* eventInstance = NULL;
-		result = eventDescription->createInstance(&eventInstance);
-
-		if (result != FMOD_OK) 
-		{
-			return false;
-		}
+		return found->second;
+	}
 
-		Vector3 pos = { posX, posY, posZ };
-		Vector3 forward = { dirX, dirY, dirZ };
-		Vector3 up = { oX, oY, oZ };
+	SetterShadow& shadow = setterShadows[target];
+	shadow.known = 0;
+	shadow.hasAttributes = false;
+	return shadow;
+}
 
-		FMOD_3D_ATTRIBUTES attributes; To3DAttributes(pos, forward, up, attributes);
+// Returns true if the write is unchanged and should be dropped. The shadow is
+// only updated by the Remember* functions once the write went through, so a
+// failed call is tried again next time.
+static bool SuppressValue(void* target, DeferredField field, float value, float epsilon)
+{
+	if (!dirtyTracking)
+	{
+		return false;
+	}
 
-		eventInstance->set3DAttributes(&attributes);
-		eventInstance->start();
-		eventInstance->release();
+	auto found = setterShadows.find(target);
+	unsigned int bit = 1u << field;
 
+	if (found != setterShadows.end() && (found->second.known & bit) &&
+		std::fabs(found->second.values[field] - value) <= epsilon)
+	{
+		suppressedSetters++;
 		return true;
 	}
-	else
-		return false;
+
+	return false;
 }
 
-bool SetInstanceVolume(const unsigned int& index, float volume)
+static void RememberValue(void* target, DeferredField field, float value)
 {
-	std::size_t i = (std::size_t)round(index);
-
-	if (instanceList.count(i) == 0) 
+	if (!dirtyTracking)
 	{
-		return false;
+		return;
 	}
 
-	auto result = instanceList[i]->setVolume(volume);
-
-	return ERROR_CHECK(result);
+	SetterShadow& shadow = GetSetterShadow(target);
+	shadow.known |= 1u << field;
+	shadow.values[field] = value;
 }
 
-bool IsPlaying(const unsigned int& index)
+static bool SuppressParameter(void* target, const FMOD_STUDIO_PARAMETER_ID& id, float value)
 {
-	std::size_t i = (std::size_t)round(index);
-
-	if (instanceList.count(i) == 0) 
+	if (!dirtyTracking)
 	{
 		return false;
 	}
 
-	FMOD_STUDIO_PLAYBACK_STATE pS = FMOD_STUDIO_PLAYBACK_STATE::FMOD_STUDIO_PLAYBACK_STOPPED;
-
-	auto result = instanceList[i]->getPlaybackState(&pS);
+	auto shadow = setterShadows.find(target);
 
-	if (result != FMOD_OK) 
+	if (shadow == setterShadows.end())
 	{
 		return false;
 	}
 
-	if (pS == FMOD_STUDIO_PLAYBACK_PLAYING) 
+	auto found = shadow->second.parameters.find(PackParameterID(id));
+
+	if (found != shadow->second.parameters.end() && std::fabs(found->second - value) <= dirtyEpsilons[DIRTY_PARAMETER])
 	{
+		suppressedSetters++;
 		return true;
 	}
-	else
-	{
-		return false;
-	}	
+
+	return false;
 }
 
-bool SetInstancePaused(const unsigned int& index, bool pause)
+static void RememberParameters(void* target, const FMOD_STUDIO_PARAMETER_ID* ids, const float* values, int count)
 {
-	std::size_t i = (std::size_t)round(index);
-
-	if (instanceList.count(i) == 0) 
+	if (!dirtyTracking)
 	{
-		return false;
+		return;
 	}
 
-	auto result = instanceList[i]->setPaused(pause);
+	SetterShadow& shadow = GetSetterShadow(target);
 
-	return ERROR_CHECK(result);
+	for (int i = 0; i < count; i++)
+	{
+		shadow.parameters[PackParameterID(ids[i])] = values[i];
+	}
 }
 
-bool SetInstancePitch(const unsigned int& index, float pitch)
+static bool VectorsClose(const FMOD_VECTOR& a, const FMOD_VECTOR& b, float epsilon)
 {
-	std::size_t i = (std::size_t)round(index);
+	return std::fabs(a.x - b.x) <= epsilon && std::fabs(a.y - b.y) <= epsilon && std::fabs(a.z - b.z) <= epsilon;
+}
 
-	if (instanceList.count(i) == 0)
+static bool SuppressAttributes(void* target, const FMOD_3D_ATTRIBUTES& attributes)
+{
+	if (!dirtyTracking)
 	{
 		return false;
 	}
 
-	auto result = instanceList[i]->setPitch(pitch);
+	auto found = setterShadows.find(target);
 
-	return ERROR_CHECK(result);
-}
-
-float GetInstancePitch(const unsigned int& index)
-{
-	std::size_t i = (std::size_t)round(index);
-
-	if (instanceList.count(i) == 0) 
+	if (found == setterShadows.end() || !found->second.hasAttributes)
 	{
-		return -1.f;
+		return false;
 	}
 
-	float pitch = 0;
-	float finalPitch = 0;
+	const FMOD_3D_ATTRIBUTES& shadow = found->second.attributes;
 
-	auto result = instanceList[i]->getPitch(&pitch, &finalPitch);
-
-	if (result != FMOD_OK) 
+	if (VectorsClose(shadow.position, attributes.position, dirtyEpsilons[DIRTY_POSITION]) &&
+		VectorsClose(shadow.velocity, attributes.velocity, dirtyEpsilons[DIRTY_VELOCITY]) &&
+		VectorsClose(shadow.forward, attributes.forward, dirtyEpsilons[DIRTY_ORIENTATION]) &&
+		VectorsClose(shadow.up, attributes.up, dirtyEpsilons[DIRTY_ORIENTATION]))
 	{
-		return -1.f;
+		suppressedSetters++;
+		return true;
 	}
 
-	return finalPitch;
+	return false;
 }
 
-int GetTimelinePosition(const unsigned int& index)
+static void RememberAttributes(void* target, const FMOD_3D_ATTRIBUTES& attributes)
 {
-	std::size_t i = (std::size_t)round(index);
-
-	if (instanceList.count(i) == 0) 
+	if (!dirtyTracking)
 	{
-		return -1;
+		return;
 	}
 
-	int position = 0;
+	SetterShadow& shadow = GetSetterShadow(target);
+	shadow.hasAttributes = true;
+	shadow.attributes = attributes;
+}
 
-	auto result = instanceList[i]->getTimelinePosition(&position);
+static bool ApplyInstanceVolume(FMOD::Studio::EventInstance* instance, float volume)
+{
+	if (SuppressValue(instance, DEFERRED_INSTANCE_VOLUME, volume, dirtyEpsilons[DIRTY_VOLUME]))
+	{
+		return true;
+	}
 
-	if (result != FMOD_OK) 
+	if (deferredMode)
 	{
-		return -1;
+		DeferCommand(instance, DEFERRED_INSTANCE_VOLUME, 0, volume, false);
+	}
+	else if (!ERROR_CHECK(instance->setVolume(volume)))
+	{
+		return false;
 	}
 
-	return position;
+	RememberValue(instance, DEFERRED_INSTANCE_VOLUME, volume);
+	return true;
 }
 
-bool SetTimelinePosition(const unsigned int& index, const unsigned int& position)
+static bool ApplyInstancePitch(FMOD::Studio::EventInstance* instance, float pitch)
 {
-	std::size_t i = (std::size_t)round(index);
+	if (SuppressValue(instance, DEFERRED_INSTANCE_PITCH, pitch, dirtyEpsilons[DIRTY_PITCH]))
+	{
+		return true;
+	}
 
-	if (instanceList.count(i) == 0) 
+	if (deferredMode)
+	{
+		DeferCommand(instance, DEFERRED_INSTANCE_PITCH, 0, pitch, false);
+	}
+	else if (!ERROR_CHECK(instance->setPitch(pitch)))
 	{
 		return false;
 	}
 
-	auto result = instanceList[i]->setTimelinePosition(position);
-
-	return ERROR_CHECK(result);
+	RememberValue(instance, DEFERRED_INSTANCE_PITCH, pitch);
+	return true;
 }
 
-float GetInstanceRMS(const unsigned int& index)
+static bool ApplyInstancePaused(FMOD::Studio::EventInstance* instance, bool paused)
 {
-	std::size_t i = (std::size_t)round(index);
-
-	if (instanceList.count(i) == 0) 
+	if (SuppressValue(instance, DEFERRED_INSTANCE_PAUSED, paused ? 1.f : 0.f, 0.f))
 	{
-		return -1;
+		return true;
 	}
 
-	FMOD::ChannelGroup* ChanGroup = nullptr;
-	instanceList[i]->getChannelGroup(&ChanGroup);
-	if (ChanGroup) 
+	if (deferredMode)
 	{
-		FMOD::DSP* ChanDSP = nullptr;
-		ChanGroup->getDSP(0, &ChanDSP);
-		if (ChanDSP) 
-		{
-			ChanDSP->setMeteringEnabled(false, true);
-			FMOD_DSP_METERING_INFO Info = {};
-			ChanDSP->getMeteringInfo(nullptr, &Info);
-
-			float rms = 0.f;
-
-			for (int i = 0; i < Info.numchannels; i++) 
-			{
-				rms += Info.rmslevel[i] * Info.rmslevel[i];
-			}
+		DeferCommand(instance, DEFERRED_INSTANCE_PAUSED, 0, 0.f, paused);
+	}
+	else if (!ERROR_CHECK(instance->setPaused(paused)))
+	{
+		return false;
+	}
 
-			rms = std::sqrt(rms / (float)Info.numchannels);
+	RememberValue(instance, DEFERRED_INSTANCE_PAUSED, paused ? 1.f : 0.f);
+	return true;
+}
 
-			float dB = rms > 0 ? 20.0f * std::log10(rms * std::sqrt(2.0f)) : -80.0f;
-			if (dB > 10.0f)
-				dB = 10.0f;
-			return dB;
-		}
-		else
-			return -1.f;
+// Seeking is never dropped, since setting the same position again restarts
+// from it.
+static bool ApplyTimelinePosition(FMOD::Studio::EventInstance* instance, int position)
+{
+	if (deferredMode)
+	{
+		DeferCommand(instance, DEFERRED_INSTANCE_TIMELINE_POSITION, 0, static_cast<float>(position), false);
+		return true;
 	}
-	else
-		return -1.f;
+
+	return ERROR_CHECK(instance->setTimelinePosition(position));
 }
 
-float GetGlobalParameterByName(const char* parameterName)
+static bool ApplyInstance3DAttributes(FMOD::Studio::EventInstance* instance, const FMOD_3D_ATTRIBUTES& attributes)
 {
-	float value, finalValue;
-	auto result = studioSystem->getParameterByName(parameterName, &value, &finalValue);
+	if (SuppressAttributes(instance, attributes))
+	{
+		return true;
+	}
 
-	if (result != FMOD_OK) 
+	if (deferredMode)
 	{
-		return -1.f;
+		DeferCommand(instance, DEFERRED_INSTANCE_3D_ATTRIBUTES, 0, 0.f, false, &attributes);
+	}
+	else if (!ERROR_CHECK(instance->set3DAttributes(&attributes)))
+	{
+		return false;
 	}
 
-	return finalValue;
+	RememberAttributes(instance, attributes);
+	return true;
 }
 
-bool SetGlobalParameterByName(const char* parameterName, float value,
-	bool ignoreSeekSpeed)
+// Applies up to MaxParametersPerCall parameters to an instance, or global
+// parameters when instance is null. Unchanged values are dropped first and
+// the rest go out in a single call.
+static bool ApplyParameters(FMOD::Studio::EventInstance* instance, const FMOD_STUDIO_PARAMETER_ID* ids,
+	const float* values, int count, bool ignoreSeekSpeed)
 {
-	auto result = studioSystem->setParameterByName(parameterName, value, ignoreSeekSpeed);
+	FMOD_STUDIO_PARAMETER_ID changedIds[MaxParametersPerCall];
+	float changedValues[MaxParametersPerCall];
+	int changed = 0;
 
-	return ERROR_CHECK(result);
-}
+	for (int i = 0; i < count; i++)
+	{
+		if (!SuppressParameter(instance, ids[i], values[i]))
+		{
+			changedIds[changed] = ids[i];
+			changedValues[changed] = values[i];
+			changed++;
+		}
+	}
 
-float GetParameterByName(const unsigned int& index, const char* parameterName)
-{
-	std::size_t i = (std::size_t)round(index);
+	if (changed == 0)
+	{
+		return true;
+	}
 
-	if (instanceList.count(i) == 0) 
+	if (deferredMode)
 	{
-		return -1.f;
+		DeferredField field = instance ? DEFERRED_INSTANCE_PARAMETER : DEFERRED_GLOBAL_PARAMETER;
+
+		for (int i = 0; i < changed; i++)
+		{
+			DeferCommand(instance, field, PackParameterID(changedIds[i]), changedValues[i], ignoreSeekSpeed);
+		}
+
+		RememberParameters(instance, changedIds, changedValues, changed);
+		return true;
 	}
 
-	float value, finalValue;
+	FMOD_RESULT result;
 
-	auto result = instanceList[i]->getParameterByName(parameterName, &value, &finalValue);
+	if (changed == 1)
+	{
+		result = instance ? instance->setParameterByID(changedIds[0], changedValues[0], ignoreSeekSpeed) :
+			studioSystem->setParameterByID(changedIds[0], changedValues[0], ignoreSeekSpeed);
+	}
+	else
+	{
+		result = instance ? instance->setParametersByIDs(changedIds, changedValues, changed, ignoreSeekSpeed) :
+			studioSystem->setParametersByIDs(changedIds, changedValues, changed, ignoreSeekSpeed);
+	}
 
-	if (result != FMOD_OK) 
+	if (!ERROR_CHECK(result))
 	{
-		return -1.f;
+		return false;
 	}
 
-	return finalValue;
+	RememberParameters(instance, changedIds, changedValues, changed);
+	return true;
 }
 
-bool SetParameterByName(const unsigned int& index, const char* parameterName, float value,
+// By name writes go straight to FMOD unless they need the parameter's ID:
+// deferred mode merges a by-name and a by-ID write to the same parameter, and
+// dirty tracking shares one shadow value between them.
+static bool ApplyParameterByName(FMOD::Studio::EventInstance* instance, const char* parameterName, float value,
 	bool ignoreSeekSpeed)
 {
-	std::size_t i = (std::size_t)round(index);
-
-	if (instanceList.count(i) == 0) 
+	if (!parameterName)
 	{
 		return false;
 	}
 
-	auto result = instanceList[i]->setParameterByName(parameterName, value,
-		ignoreSeekSpeed);
+	if (!deferredMode && !dirtyTracking)
+	{
+		return ERROR_CHECK(instance ? instance->setParameterByName(parameterName, value, ignoreSeekSpeed) :
+			studioSystem->setParameterByName(parameterName, value, ignoreSeekSpeed));
+	}
+
+	FMOD::Studio::EventDescription* eventDescription = nullptr;
+	FMOD_STUDIO_PARAMETER_DESCRIPTION parameterDescription;
+	FMOD_RESULT result;
 
-	return ERROR_CHECK(result);
-}
+	if (instance)
+	{
+		result = instance->getDescription(&eventDescription);
 
-int GetBus(const char* busPath)
-{
-	FMOD::Studio::Bus* bus = nullptr;
-	auto result = studioSystem->getBus(busPath, &bus);
-	if (result == FMOD_OK) 
+		if (result == FMOD_OK)
+		{
+			result = eventDescription->getParameterDescriptionByName(parameterName, &parameterDescription);
+		}
+	}
+	else
 	{
-		busList.emplace(nBusses++, bus);
-		return static_cast<int>(nBusses - 1);
+		result = studioSystem->getParameterDescriptionByName(parameterName, &parameterDescription);
 	}
-	else 
+
+	if (!ERROR_CHECK(result))
 	{
-		return -1;
+		return false;
 	}
+
+	return ApplyParameters(instance, &parameterDescription.id, &value, 1, ignoreSeekSpeed);
 }
 
-float GetBusVolume(const unsigned int& index)
+static bool ApplyBusVolume(FMOD::Studio::Bus* bus, float volume)
 {
-	std::size_t i = (std::size_t)round(index);
-
-	if (busList.count(i) == 0) 
+	if (SuppressValue(bus, DEFERRED_BUS_VOLUME, volume, dirtyEpsilons[DIRTY_VOLUME]))
 	{
-		return -1.f;
+		return true;
 	}
 
-	float volume, finalVolume;
-
-	auto result = busList[i]->getVolume(&volume, &finalVolume);
-
-	if (result != FMOD_OK) 
+	if (deferredMode)
 	{
-		return -1.f;
+		DeferCommand(bus, DEFERRED_BUS_VOLUME, 0, volume, false);
 	}
-	else 
+	else if (!ERROR_CHECK(bus->setVolume(volume)))
 	{
-		return finalVolume;
+		return false;
 	}
+
+	RememberValue(bus, DEFERRED_BUS_VOLUME, volume);
+	return true;
 }
 
-bool SetBusVolume(const unsigned int& index, float volume)
+static bool ApplyVCAVolume(FMOD::Studio::VCA* vca, float volume)
 {
-	std::size_t i = (std::size_t)round(index);
-
-	if (busList.count(i) == 0) {
-		return false;
+	if (SuppressValue(vca, DEFERRED_VCA_VOLUME, volume, dirtyEpsilons[DIRTY_VOLUME]))
+	{
+		return true;
 	}
 
-	auto result = busList[i]->setVolume(volume);
-
-	if (result != FMOD_OK) {
+	if (deferredMode)
+	{
+		DeferCommand(vca, DEFERRED_VCA_VOLUME, 0, volume, false);
+	}
+	else if (!ERROR_CHECK(vca->setVolume(volume)))
+	{
 		return false;
 	}
-	else
-		return 1;
-}
 
-int GetVCA(const char* vcaPath)
-{
-	FMOD::Studio::VCA* vca = nullptr;
-	auto result = studioSystem->getVCA(vcaPath, &vca);
-	if (result == FMOD_OK) {
-		vcaList.emplace(nVCAs++, vca);
-		return static_cast<int>(nVCAs - 1);
-	}
-	else
-		return -1;
+	RememberValue(vca, DEFERRED_VCA_VOLUME, volume);
+	return true;
 }
 
-float GetVCAVolume(const unsigned int& index)
+// Event callbacks. FMOD calls EventCallback() on its own thread (or from
+// update() with FMOD_STUDIO_INIT_SYNCHRONOUS_UPDATE), which only copies the
+// callback into a record and pushes it onto the ring. Update() drains the ring
+// on the Lua thread, so neither side ever waits on a lock. Records that don't
+// fit because the ring is full are dropped and counted.
+SpscRing<EventCallbackRecord, 1024> eventCallbackRing;
+std::vector<EventCallbackRecord> eventCallbacks;
+std::atomic<long long> eventCallbacksDropped(0);
+
+static FMOD_RESULT F_CALL EventCallback(FMOD_STUDIO_EVENT_CALLBACK_TYPE type, FMOD_STUDIO_EVENTINSTANCE* event,
+	void* parameters)
 {
-	std::size_t i = (std::size_t)round(index);
+	auto instance = reinterpret_cast<FMOD::Studio::EventInstance*>(event);
+	void* userData = nullptr;
+	instance->getUserData(&userData);
 
-	if (vcaList.count(i) == 0) {
-		return -1;
+	EventCallbackRecord record = {};
+	record.tag = static_cast<int>(reinterpret_cast<std::intptr_t>(userData));
+	record.type = type;
+
+	FMOD::ChannelGroup* masterGroup = nullptr;
+
+	if (coreSystem->getMasterChannelGroup(&masterGroup) == FMOD_OK)
+	{
+		masterGroup->getDSPClock(&record.dspClock, nullptr);
 	}
 
-	float volume, finalVolume;
+	if (type == FMOD_STUDIO_EVENT_CALLBACK_TIMELINE_MARKER)
+	{
+		auto marker = static_cast<FMOD_STUDIO_TIMELINE_MARKER_PROPERTIES*>(parameters);
+		record.position = marker->position;
 
-	auto result = vcaList[i]->getVolume(&volume, &finalVolume);
+		if (marker->name)
+		{
+			std::strncpy(record.name, marker->name, EventCallbackNameLength - 1);
+		}
+	}
+	else if (type == FMOD_STUDIO_EVENT_CALLBACK_TIMELINE_BEAT)
+	{
+		auto beat = static_cast<FMOD_STUDIO_TIMELINE_BEAT_PROPERTIES*>(parameters);
+		record.position = beat->position;
+		record.bar = beat->bar;
+		record.beat = beat->beat;
+		record.tempo = beat->tempo;
+	}
 
-	if (result != FMOD_OK) {
-		return -1;
+	if (!eventCallbackRing.Push(record))
+	{
+		eventCallbacksDropped++;
 	}
-	else
-		return finalVolume;
+
+	return FMOD_OK;
 }
 
-bool SetVCAVolume(const unsigned int& index, float volume)
+// The tag is stored as the instance's user data so the callback can report it
+// without looking anything up. A mask of 0 removes the callback.
+bool SetEventCallback(FMOD::Studio::EventInstance* instance, FMOD_STUDIO_EVENT_CALLBACK_TYPE mask, int tag)
 {
-	std::size_t i = (std::size_t)round(index);
-
-	if (vcaList.count(i) == 0) {
+	if (!instance)
+	{
 		return false;
 	}
 
-	auto result = vcaList[i]->setVolume(volume);
+	mask &= EventCallbackMask;
 
-	if (result != FMOD_OK) {
-		return false;
+	if (mask == 0)
+	{
+		return ERROR_CHECK(instance->setCallback(nullptr, 0));
 	}
-	else
-		return 1;
-}
 
-static int love_fmod_init(lua_State* L)
-{
-	lua_pushboolean(L,
-		Init(LuaIntDefault(L, 1, 0), LuaIntDefault(L, 2, 32),
-			LuaIntDefault(L, 3, 128), LuaIntDefault(L, 4, 1)));
-	return 1;
+	return ERROR_CHECK(instance->setUserData(reinterpret_cast<void*>(static_cast<std::intptr_t>(tag)))) &&
+		ERROR_CHECK(instance->setCallback(EventCallback, mask));
 }
 
-static int love_fmod_update(lua_State* L)
+void DrainEventCallbacks()
 {
-	bool result = Update();
-	lua_pushboolean(L, result);
-	return 1;
+	EventCallbackRecord record;
+
+	while (eventCallbackRing.Pop(record))
+	{
+		eventCallbacks.push_back(record);
+	}
 }
 
-static int love_fmod_load_bank(lua_State* L)
+// Size-class pool allocator handed to FMOD::Memory_Initialize. Allocations up
+// to the largest class are served from per-class free lists carved out of
+// fixed size chunks, which are never returned to the system, so FMOD's churn
+// of small blocks stays out of the game's heap. Larger allocations go to
+// malloc. Every block starts with a 16 byte header recording its class and
+// requested size, which keeps the returned memory 16 byte aligned.
+struct PoolHeader {
+	unsigned int sizeClass;
+	unsigned int size;
+	unsigned int padding[2];
+};
+
+static_assert(sizeof(PoolHeader) == 16, "PoolHeader must keep blocks 16 byte aligned");
+
+const unsigned int PoolSizeClassCount = 9;
+const std::size_t PoolSmallestBlock = 32;
+const std::size_t PoolChunkSize = 64 * 1024;
+const unsigned int PoolLargeClass = 0xFFFFFFFFu;
+
+struct PoolFreeBlock {
+	PoolFreeBlock* next;
+};
+
+struct PoolSizeClass {
+	std::mutex lock;
+	PoolFreeBlock* freeList = nullptr;
+	long long inUse = 0;
+	long long peakInUse = 0;
+	long long allocations = 0;
+	long long chunks = 0;
+};
+
+PoolSizeClass poolSizeClasses[PoolSizeClassCount];
+
+MemoryMode memoryMode = MEMORY_SYSTEM;
+std::atomic<long long> poolCurrentBytes(0);
+std::atomic<long long> poolPeakBytes(0);
+std::atomic<long long> poolLargeBytes(0);
+std::atomic<long long> poolLargeAllocations(0);
+std::atomic<long long> poolFailedAllocations(0);
+
+static std::size_t PoolBlockSize(unsigned int sizeClass)
 {
-	const char* input = lua_tostring(L, 1);
-	int flags = static_cast<int>(lua_tointeger(L, 2));
-	int index = LoadBank(input, flags);
-	lua_Integer i = static_cast<lua_Integer>(index);
-	lua_pushinteger(L, i);
-	return 1;
+	return PoolSmallestBlock << sizeClass;
 }
 
-static int love_fmod_unload_bank(lua_State* L)
+static unsigned int PoolSizeClassFor(std::size_t total)
 {
-	int index = static_cast<int>(lua_tointeger(L, 1));
-	bool result = UnloadBank(index);
-	lua_pushboolean(L, result);
-	return 1;
+	for (unsigned int sizeClass = 0; sizeClass < PoolSizeClassCount; sizeClass++)
+	{
+		if (total <= PoolBlockSize(sizeClass))
+		{
+			return sizeClass;
+		}
+	}
+
+	return PoolLargeClass;
 }
 
-static int love_fmod_setnumlisteners(lua_State* L)
+static void PoolTrackBytes(long long delta)
 {
-	int listeners = static_cast<int>(lua_tointeger(L, 1));
-	bool result = SetNumListeners(listeners);
-	lua_pushboolean(L, result);
-	return 1;
+	long long current = poolCurrentBytes.fetch_add(delta) + delta;
+	long long peak = poolPeakBytes.load();
+
+	while (current > peak && !poolPeakBytes.compare_exchange_weak(peak, current))
+	{
+	}
 }
 
-static int love_fmod_set_listener3d_position(lua_State* L)
+static void* PoolAllocateBlock(unsigned int sizeClass)
 {
-	int listener = static_cast<int>(lua_tointeger(L, 1));
-	float posX = static_cast<float>(lua_tonumber(L, 2));
-	float posY = static_cast<float>(lua_tonumber(L, 3));
-	float posZ = static_cast<float>(lua_tonumber(L, 4));
-	float dirX = static_cast<float>(lua_tonumber(L, 5));
-	float dirY = static_cast<float>(lua_tonumber(L, 6));
-	float dirZ = static_cast<float>(lua_tonumber(L, 7));
-	float oX = static_cast<float>(lua_tonumber(L, 8));
-	float oY = static_cast<float>(lua_tonumber(L, 9));
-	float oZ = static_cast<float>(lua_tonumber(L, 10));
+	PoolSizeClass& pool = poolSizeClasses[sizeClass];
+	std::lock_guard<std::mutex> guard(pool.lock);
 
-	bool result = SetListener3DPosition(listener, posX, posY, posZ, dirX, dirY,
-		dirZ, oX, oY, oZ);
-	lua_pushboolean(L, result);
-	return 1;
+	if (!pool.freeList)
+	{
+		std::size_t blockSize = PoolBlockSize(sizeClass);
+		auto chunk = static_cast<char*>(std::malloc(PoolChunkSize));
+
+		if (!chunk)
+		{
+			return nullptr;
+		}
+
+		for (std::size_t offset = 0; offset + blockSize <= PoolChunkSize; offset += blockSize)
+		{
+			auto block = reinterpret_cast<PoolFreeBlock*>(chunk + offset);
+			block->next = pool.freeList;
+			pool.freeList = block;
+		}
+
+		pool.chunks++;
+	}
+
+	PoolFreeBlock* block = pool.freeList;
+	pool.freeList = block->next;
+	pool.inUse++;
+	pool.allocations++;
+	pool.peakInUse = std::max(pool.peakInUse, pool.inUse);
+
+	return block;
 }
 
-static int love_fmod_create_instance(lua_State* L)
+static void PoolFreeBlockTo(unsigned int sizeClass, void* memory)
 {
-	const char* input = lua_tostring(L, 1);
-	int index = CreateInstance(input);
-	lua_pushinteger(L, index);
-	return 1;
+	PoolSizeClass& pool = poolSizeClasses[sizeClass];
+	std::lock_guard<std::mutex> guard(pool.lock);
+
+	auto block = static_cast<PoolFreeBlock*>(memory);
+	block->next = pool.freeList;
+	pool.freeList = block;
+	pool.inUse--;
 }
 
-static int love_fmod_start_instance(lua_State* L)
+static void* F_CALL PoolAlloc(unsigned int size, FMOD_MEMORY_TYPE, const char*)
 {
-	int index = static_cast<int>(lua_tointeger(L, 1));
-	bool result = StartInstance(index);
-	lua_pushboolean(L, result);
-	return 1;
-}
+	std::size_t total = static_cast<std::size_t>(size) + sizeof(PoolHeader);
+	unsigned int sizeClass = PoolSizeClassFor(total);
+	void* memory;
+
+	if (sizeClass == PoolLargeClass)
+	{
+		memory = std::malloc(total);
+		if (memory)
+		{
+			poolLargeAllocations++;
+			poolLargeBytes += static_cast<long long>(total);
+		}
+	}
+	else
+	{
+		memory = PoolAllocateBlock(sizeClass);
+	}
+
+	if (!memory)
+	{
+		poolFailedAllocations++;
+		return nullptr;
+	}
+
+	auto header = static_cast<PoolHeader*>(memory);
+	header->sizeClass = sizeClass;
+	header->size = size;
+	PoolTrackBytes(size);
+
+	return header + 1;
+}
+
+static void F_CALL PoolFree(void* ptr, FMOD_MEMORY_TYPE, const char*)
+{
+	if (!ptr)
+	{
+		return;
+	}
+
+	auto header = static_cast<PoolHeader*>(ptr) - 1;
+	PoolTrackBytes(-static_cast<long long>(header->size));
+
+	if (header->sizeClass == PoolLargeClass)
+	{
+		poolLargeAllocations--;
+		poolLargeBytes -= static_cast<long long>(header->size + sizeof(PoolHeader));
+		std::free(header);
+	}
+	else
+	{
+		PoolFreeBlockTo(header->sizeClass, header);
+	}
+}
+
+static void* F_CALL PoolRealloc(void* ptr, unsigned int size, FMOD_MEMORY_TYPE type, const char* sourcestr)
+{
+	if (!ptr)
+	{
+		return PoolAlloc(size, type, sourcestr);
+	}
+
+	auto header = static_cast<PoolHeader*>(ptr) - 1;
+
+	// Stay in place when the block still fits and isn't more than twice as big
+	// as it needs to be.
+	if (header->sizeClass != PoolLargeClass &&
+		PoolSizeClassFor(static_cast<std::size_t>(size) + sizeof(PoolHeader)) == header->sizeClass)
+	{
+		PoolTrackBytes(static_cast<long long>(size) - static_cast<long long>(header->size));
+		header->size = size;
+		return ptr;
+	}
+
+	void* memory = PoolAlloc(size, type, sourcestr);
+
+	if (!memory)
+	{
+		return nullptr;
+	}
+
+	std::memcpy(memory, ptr, std::min(size, header->size));
+	PoolFree(ptr, type, sourcestr);
+
+	return memory;
+}
+
+// Installs the allocator picked in the options. FMOD only accepts this before
+// the first System is created, so it runs at most once per process.
+bool InitializeMemory(const InitOptions& options)
+{
+	static bool initialized = false;
+
+	if (initialized || options.memoryMode == MEMORY_SYSTEM)
+	{
+		return true;
+	}
+
+	FMOD_RESULT result;
+
+	if (options.memoryMode == MEMORY_POOL)
+	{
+		result = FMOD::Memory_Initialize(nullptr, 0, PoolAlloc, PoolRealloc, PoolFree);
+	}
+	else
+	{
+		// FMOD wants a multiple of 512 bytes that fits in an int.
+		int arenaLength = static_cast<int>(std::min(options.arenaSize, static_cast<unsigned int>(INT_MAX)) & ~511u);
+
+		if (arenaLength == 0)
+		{
+			return false;
+		}
+
+		// FMOD manages the arena itself. It has to stay valid for as long as
+		// FMOD runs, so it is never freed.
+		void* arena = std::malloc(arenaLength);
+
+		if (!arena)
+		{
+			return false;
+		}
+
+		result = FMOD::Memory_Initialize(arena, arenaLength, nullptr, nullptr, nullptr);
+
+		if (result != FMOD_OK)
+		{
+			std::free(arena);
+		}
+	}
+
+	if (result != FMOD_OK)
+	{
+		return false;
+	}
+
+	initialized = true;
+	memoryMode = options.memoryMode;
+
+	return true;
+}
+
+void GetMemoryStats(MemoryStats& outStats)
+{
+	outStats.mode = memoryMode;
+	outStats.sizeClasses.clear();
+
+	if (memoryMode != MEMORY_POOL)
+	{
+		// FMOD tracks these itself for its own arena and for the system heap.
+		int current = 0, peak = 0;
+		FMOD::Memory_GetStats(&current, &peak, false);
+
+		outStats.currentBytes = current;
+		outStats.peakBytes = peak;
+		outStats.reservedBytes = 0;
+		outStats.failedAllocations = 0;
+		outStats.largeAllocations = 0;
+		return;
+	}
+
+	outStats.currentBytes = poolCurrentBytes.load();
+	outStats.peakBytes = poolPeakBytes.load();
+	outStats.failedAllocations = poolFailedAllocations.load();
+	outStats.largeAllocations = poolLargeAllocations.load();
+	outStats.reservedBytes = poolLargeBytes.load();
+
+	for (unsigned int sizeClass = 0; sizeClass < PoolSizeClassCount; sizeClass++)
+	{
+		PoolSizeClass& pool = poolSizeClasses[sizeClass];
+		std::lock_guard<std::mutex> guard(pool.lock);
+
+		outStats.sizeClasses.push_back({ PoolBlockSize(sizeClass), pool.inUse, pool.peakInUse, pool.allocations,
+			pool.chunks });
+		outStats.reservedBytes += pool.chunks * static_cast<long long>(PoolChunkSize);
+	}
+}
+
+OfflineCapture offlineCapture = { nullptr, 0, 0, 0, 0.0, 0.0 };
+
+const std::uint64_t FnvOffsetBasis = 14695981039346656037ULL;
+const std::uint64_t FnvPrime = 1099511628211ULL;
+
+// Runs on the update thread, since offline mode mixes from update. Passes the
+// master output through unchanged and folds it into the hash.
+static FMOD_RESULT F_CALL OfflineCaptureRead(FMOD_DSP_STATE* dspState, float* inBuffer, float* outBuffer,
+	unsigned int length, int inChannels, int* outChannels)
+{
+	int channels = *outChannels;
+	std::uint64_t hash = offlineCapture.hash;
+
+	for (unsigned int frame = 0; frame < length; frame++)
+	{
+		for (int channel = 0; channel < channels; channel++)
+		{
+			float sample = channel < inChannels ? inBuffer[frame * inChannels + channel] : 0.f;
+			outBuffer[frame * channels + channel] = sample;
+
+			float clamped = std::min(std::max(sample, -1.f), 1.f);
+			auto quantized = static_cast<std::uint16_t>(static_cast<std::int16_t>(std::lrint(clamped * 32767.f)));
+
+			hash = (hash ^ (quantized & 0xFF)) * FnvPrime;
+			hash = (hash ^ (quantized >> 8)) * FnvPrime;
+		}
+	}
+
+	offlineCapture.hash = hash;
+	offlineCapture.frames += length;
+	offlineCapture.channels = channels;
+
+	return FMOD_OK;
+}
+
+static bool StartOfflineCapture()
+{
+	FMOD_DSP_DESCRIPTION description = {};
+	description.pluginsdkversion = FMOD_PLUGIN_SDK_VERSION;
+	std::strncpy(description.name, "fmod-love capture", sizeof(description.name) - 1);
+	description.numinputbuffers = 1;
+	description.numoutputbuffers = 1;
+	description.read = OfflineCaptureRead;
+
+	FMOD::ChannelGroup* master = nullptr;
+
+	if (!ERROR_CHECK(coreSystem->createDSP(&description, &offlineCapture.dsp)) ||
+		!ERROR_CHECK(coreSystem->getMasterChannelGroup(&master)) ||
+		!ERROR_CHECK(master->addDSP(FMOD_CHANNELCONTROL_DSP_HEAD, offlineCapture.dsp)))
+	{
+		return false;
+	}
+
+	unsigned int bufferLength = 0;
+	int bufferCount = 0, sampleRate = 0;
+	coreSystem->getDSPBufferSize(&bufferLength, &bufferCount);
+	coreSystem->getSoftwareFormat(&sampleRate, nullptr, nullptr);
+
+	offlineCapture.blockSeconds = sampleRate > 0 ? static_cast<double>(bufferLength) / sampleRate : 0.0;
+	ResetOfflineCapture();
+
+	return true;
+}
+
+bool IsOffline()
+{
+	return offlineCapture.dsp != nullptr;
+}
+
+const OfflineCapture& GetOfflineCapture()
+{
+	return offlineCapture;
+}
+
+void ResetOfflineCapture()
+{
+	offlineCapture.hash = FnvOffsetBasis;
+	offlineCapture.frames = 0;
+}
+
+// Mixer and streaming settings have to be applied between creating the
+// system and initializing it.
+static bool ApplyMixerOptions(const InitOptions& options)
+{
+	if (options.dspBufferLength > 0 || options.dspBufferCount > 0)
+	{
+		unsigned int bufferLength = 0;
+		int bufferCount = 0;
+		coreSystem->getDSPBufferSize(&bufferLength, &bufferCount);
+
+		if (options.dspBufferLength > 0)
+		{
+			bufferLength = options.dspBufferLength;
+		}
+
+		if (options.dspBufferCount > 0)
+		{
+			bufferCount = options.dspBufferCount;
+		}
+
+		if (!ERROR_CHECK(coreSystem->setDSPBufferSize(bufferLength, bufferCount)))
+		{
+			return false;
+		}
+	}
+
+	if (options.sampleRate > 0 || options.speakerMode != FMOD_SPEAKERMODE_DEFAULT)
+	{
+		int sampleRate = 0, rawSpeakers = 0;
+		FMOD_SPEAKERMODE speakerMode = FMOD_SPEAKERMODE_DEFAULT;
+		coreSystem->getSoftwareFormat(&sampleRate, &speakerMode, &rawSpeakers);
+
+		if (options.sampleRate > 0)
+		{
+			sampleRate = options.sampleRate;
+		}
+
+		if (options.speakerMode != FMOD_SPEAKERMODE_DEFAULT)
+		{
+			speakerMode = options.speakerMode;
+		}
+
+		if (!ERROR_CHECK(coreSystem->setSoftwareFormat(sampleRate, speakerMode, rawSpeakers)))
+		{
+			return false;
+		}
+	}
+
+	if (options.streamBufferMs > 0 &&
+		!ERROR_CHECK(coreSystem->setStreamBufferSize(options.streamBufferMs, FMOD_TIMEUNIT_MS)))
+	{
+		return false;
+	}
+
+	if (options.decodeBufferMs > 0 || options.vol0VirtualVol >= 0.f || options.maxVorbisCodecs > 0 ||
+		options.maxFADPCMCodecs > 0)
+	{
+		FMOD_ADVANCEDSETTINGS settings = {};
+		settings.cbSize = sizeof(settings);
+
+		if (!ERROR_CHECK(coreSystem->getAdvancedSettings(&settings)))
+		{
+			return false;
+		}
+
+		if (options.decodeBufferMs > 0)
+		{
+			settings.defaultDecodeBufferSize = options.decodeBufferMs;
+		}
+
+		if (options.vol0VirtualVol >= 0.f)
+		{
+			settings.vol0virtualvol = options.vol0VirtualVol;
+		}
+
+		if (options.maxVorbisCodecs > 0)
+		{
+			settings.maxVorbisCodecs = options.maxVorbisCodecs;
+		}
+
+		if (options.maxFADPCMCodecs > 0)
+		{
+			settings.maxFADPCMCodecs = options.maxFADPCMCodecs;
+		}
+
+		if (!ERROR_CHECK(coreSystem->setAdvancedSettings(&settings)))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool Init(const unsigned int& outputType, const unsigned int& realChannels, const unsigned int& virtualChannels,
+	const unsigned int& studioInitFlags, const InitOptions& options)
+{
+	if (!InitializeMemory(options))
+	{
+		return false;
+	}
+
+	auto result = FMOD::Studio::System::create(&studioSystem);
+
+	if (result != FMOD_OK) {
+		return false;
+	}
+
+	result = studioSystem->getCoreSystem(&coreSystem);
+
+	if (result != FMOD_OK) {
+		return false;
+	}
+
+	FMOD_OUTPUTTYPE output = (FMOD_OUTPUTTYPE)outputType;
+	FMOD_STUDIO_INITFLAGS studioFlags = (FMOD_STUDIO_INITFLAGS)studioInitFlags;
+	FMOD_INITFLAGS coreFlags = FMOD_INIT_NORMAL;
+	void* driverData = NULL;
+
+	// Offline rendering runs everything from update on the calling thread so
+	// that the same calls always produce the same output.
+	if (options.offlineMode != OFFLINE_NONE)
+	{
+		output = options.offlineMode == OFFLINE_WAV ? FMOD_OUTPUTTYPE_WAVWRITER_NRT : FMOD_OUTPUTTYPE_NOSOUND_NRT;
+		studioFlags |= FMOD_STUDIO_INIT_SYNCHRONOUS_UPDATE | FMOD_STUDIO_INIT_LOAD_FROM_UPDATE;
+		coreFlags |= FMOD_INIT_STREAM_FROM_UPDATE | FMOD_INIT_MIX_FROM_UPDATE;
+
+		if (options.offlineMode == OFFLINE_WAV && !options.outputFile.empty())
+		{
+			driverData = const_cast<char*>(options.outputFile.c_str());
+		}
+	}
+
+	result = coreSystem->setOutput(output);
+
+	if (result != FMOD_OK) {
+		return false;
+	}
+
+	result = coreSystem->setSoftwareChannels(realChannels);
+
+	if (result != FMOD_OK) {
+		return false;
+	}
+
+	if (!ApplyMixerOptions(options))
+	{
+		return false;
+	}
+
+	// vol0virtualvol is only used with this flag.
+	if (options.vol0VirtualVol >= 0.f)
+	{
+		coreFlags |= FMOD_INIT_VOL0_BECOMES_VIRTUAL;
+	}
+
+	result = studioSystem->initialize(virtualChannels, studioFlags, coreFlags, driverData);
+
+	if (result != FMOD_OK) 
+	{
+		return false;
+	}
+
+	if (options.offlineMode != OFFLINE_NONE && !StartOfflineCapture())
+	{
+		return false;
+	}
+
+	return 1;
+}
+
+// The output latency is the whole ring of mixer blocks; one block is also
+// the interval at which the mixer wakes up.
+bool GetLatencyInfo(LatencyInfo& outInfo)
+{
+	if (!coreSystem)
+	{
+		return false;
+	}
+
+	int rawSpeakers = 0;
+
+	if (!ERROR_CHECK(coreSystem->getDSPBufferSize(&outInfo.dspBufferLength, &outInfo.dspBufferCount)) ||
+		!ERROR_CHECK(coreSystem->getSoftwareFormat(&outInfo.sampleRate, &outInfo.speakerMode, &rawSpeakers)) ||
+		!ERROR_CHECK(coreSystem->getStreamBufferSize(&outInfo.streamBufferSize, &outInfo.streamBufferUnit)))
+	{
+		return false;
+	}
+
+	outInfo.blockMs = outInfo.sampleRate > 0 ? 1000.0 * outInfo.dspBufferLength / outInfo.sampleRate : 0.0;
+	outInfo.latencyMs = outInfo.blockMs * outInfo.dspBufferCount;
+
+	return true;
+}
+
+bool Update()
+{
+	PollBankLoads();
+	FlushOneShots(GetClockSeconds());
+	FlushDeferredCommands();
+
+	double now = GetClockSeconds();
+	UpdateSampleResidency(now);
+	UpdateListeners(now);
+	UpdateEmitters(now);
+
+	auto result = studioSystem->update();
+
+	if (IsOffline())
+	{
+		offlineCapture.clock += offlineCapture.blockSeconds;
+	}
+
+	DrainEventCallbacks();
+	ReapStoppedInstances();
+	ReleaseUnloadedBankMappings();
+	UpdateMeters();
+	UpdateSpectrums();
+
+	return ERROR_CHECK(result);
+}
+
+bool MapFile(const char* path, MappedFile& outFile)
+{
+	outFile = { nullptr, 0, nullptr };
+
+#if defined(_WIN32)
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	HANDLE mapping = NULL;
+
+	if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+	{
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	}
+
+	// The mapping keeps the file open on its own.
+	CloseHandle(file);
+
+	if (!mapping)
+	{
+		return false;
+	}
+
+	void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+	if (!data)
+	{
+		CloseHandle(mapping);
+		return false;
+	}
+
+	outFile = { static_cast<const char*>(data), static_cast<std::size_t>(size.QuadPart), mapping };
+#else
+	int file = open(path, O_RDONLY);
+
+	if (file == -1)
+	{
+		return false;
+	}
+
+	struct stat info;
+	void* data = MAP_FAILED;
+
+	if (fstat(file, &info) == 0 && info.st_size > 0)
+	{
+		data = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_SHARED, file, 0);
+	}
+
+	// The mapping keeps the file open on its own.
+	close(file);
+
+	if (data == MAP_FAILED)
+	{
+		return false;
+	}
+
+	outFile = { static_cast<const char*>(data), static_cast<std::size_t>(info.st_size), nullptr };
+#endif
+
+	return true;
+}
+
+void UnmapFile(MappedFile& file)
+{
+	if (!file.data)
+	{
+		return;
+	}
+
+#if defined(_WIN32)
+	UnmapViewOfFile(file.data);
+	CloseHandle(static_cast<HANDLE>(file.mapping));
+#else
+	munmap(const_cast<char*>(file.data), file.length);
+#endif
+
+	file = { nullptr, 0, nullptr };
+}
+
+// Loads a bank straight from a mapped file. Returns false without touching
+// outBank if the file can't be mapped, so the caller can fall back to
+// loadBankFile.
+static bool LoadMappedBank(const char* bankPath, int flags, FMOD::Studio::Bank** outBank, FMOD_RESULT& outResult)
+{
+	MappedFile file;
+
+	// loadBankMemory takes an int length.
+	if (!MapFile(bankPath, file) || file.length > 0x7FFFFFFF)
+	{
+		UnmapFile(file);
+		return false;
+	}
+
+	outResult = studioSystem->loadBankMemory(file.data, static_cast<int>(file.length),
+		FMOD_STUDIO_LOAD_MEMORY_POINT, (FMOD_STUDIO_LOAD_BANK_FLAGS)flags, outBank);
+
+	if (outResult != FMOD_OK || !*outBank)
+	{
+		UnmapFile(file);
+		return true;
+	}
+
+	mappedBanks.push_back({ *outBank, file, false });
+
+	return true;
+}
+
+// Called once a frame after studioSystem->update() and drops the mappings of
+// banks that UnloadBank has seen through to the end on the Studio thread.
+void ReleaseUnloadedBankMappings()
+{
+	for (std::size_t i = 0; i < mappedBanks.size();)
+	{
+		MappedBank& mapped = mappedBanks[i];
+
+		if (mapped.unloading)
+		{
+			UnmapFile(mapped.file);
+			mapped = mappedBanks.back();
+			mappedBanks.pop_back();
+		}
+		else
+		{
+			i++;
+		}
+	}
+}
+
+int LoadBank(const char* bankPath, int flags, bool memoryMapped)
+{
+	FMOD::Studio::Bank* bank = nullptr;
+	FMOD_RESULT result = FMOD_OK;
+
+	if (!memoryMapped || !LoadMappedBank(bankPath, flags, &bank, result))
+	{
+		result = studioSystem->loadBankFile(
+			bankPath, (FMOD_STUDIO_LOAD_BANK_FLAGS)flags, &bank);
+	}
+
+	if (!ERROR_CHECK(result)) 
+	{
+		return -1;
+	}
+
+	if (bank) 
+	{
+		return bankList.Add(bank);
+	}
+	else
+		return -1;
+}
+
+bool UnloadBank(const unsigned int& index)
+{
+	auto bank = bankList.Get(index);
+
+	if (!bank) 
+	{
+		return false;
+	}
+
+	FlushDeferredCommands();
+
+	auto result = bank->unload();
+
+	// Descriptions owned by the bank are invalid from here on, whether or not
+	// the unload succeeded, so nothing resolved before this point is trusted.
+	ClearEventCache();
+
+	if (result != FMOD_OK)
+	{
+		return false;
+	}
+
+	// isValid() turns false as soon as unload() is called, while the Studio
+	// thread may still be unloading the bank and reading its sample data from
+	// the mapping. Flushing waits for that to finish.
+	for (auto& mapped : mappedBanks)
+	{
+		if (mapped.bank == bank)
+		{
+			ERROR_CHECK(studioSystem->flushCommands());
+			mapped.unloading = true;
+		}
+	}
+
+	bankList.Remove(index);
+
+	return true;
+}
+
+int LoadBankAsync(const char* bankPath, int flags, bool loadSampleData, bool memoryMapped)
+{
+	if (!bankPath)
+	{
+		return -1;
+	}
+
+	int index = LoadBank(bankPath, flags | FMOD_STUDIO_LOAD_BANK_NONBLOCKING, memoryMapped);
+
+	if (index == -1)
+	{
+		return -1;
+	}
+
+	if (pendingBankLoads.empty())
+	{
+		asyncBankLoadsQueued = 0;
+		asyncBankLoadsFinished = 0;
+	}
+
+	pendingBankLoads.push_back({ index, bankPath, loadSampleData, false });
+	asyncBankLoadsQueued++;
+
+	return index;
+}
+
+// Returns how far a bank has loaded, from 0 to 1. Banks that load sample data
+// count as half done once their metadata is in.
+static float BankProgress(FMOD::Studio::Bank* bank, bool loadSampleData)
+{
+	FMOD_STUDIO_LOADING_STATE state = FMOD_STUDIO_LOADING_STATE_ERROR;
+	bank->getLoadingState(&state);
+
+	if (state != FMOD_STUDIO_LOADING_STATE_LOADED)
+	{
+		return 0.f;
+	}
+
+	if (!loadSampleData)
+	{
+		return 1.f;
+	}
+
+	FMOD_STUDIO_LOADING_STATE sampleState = FMOD_STUDIO_LOADING_STATE_ERROR;
+	bank->getSampleLoadingState(&sampleState);
+
+	return sampleState == FMOD_STUDIO_LOADING_STATE_LOADED ? 1.f : 0.5f;
+}
+
+static void FinishBankLoad(const PendingBankLoad& load, bool loaded, FMOD_RESULT result)
+{
+	// A bank that failed to load still has to be unloaded to free its handle.
+	if (!loaded)
+	{
+		UnloadBank(load.bank);
+		bankList.Remove(load.bank);
+	}
+
+	bankLoadEvents.push_back({ load.bank, load.path, loaded, static_cast<int>(result) });
+	asyncBankLoadsFinished++;
+}
+
+// Advances every pending async load: requests sample data once the metadata is
+// loaded and queues a BankLoadEvent when a load completes or fails.
+void PollBankLoads()
+{
+	std::size_t kept = 0;
+
+	for (std::size_t i = 0; i < pendingBankLoads.size(); i++)
+	{
+		PendingBankLoad& load = pendingBankLoads[i];
+		auto bank = bankList.Get(load.bank);
+		bool done = true;
+
+		if (!bank)
+		{
+			// Unloaded from Lua before it finished.
+			FinishBankLoad(load, false, FMOD_ERR_INVALID_HANDLE);
+		}
+		else
+		{
+			FMOD_STUDIO_LOADING_STATE state = FMOD_STUDIO_LOADING_STATE_ERROR;
+			auto result = bank->getLoadingState(&state);
+
+			if (state == FMOD_STUDIO_LOADING_STATE_ERROR || (result != FMOD_OK && state != FMOD_STUDIO_LOADING_STATE_LOADING))
+			{
+				FinishBankLoad(load, false, result != FMOD_OK ? result : FMOD_ERR_INVALID_HANDLE);
+			}
+			else if (state != FMOD_STUDIO_LOADING_STATE_LOADED)
+			{
+				done = false;
+			}
+			else if (!load.loadSampleData)
+			{
+				FinishBankLoad(load, true, FMOD_OK);
+			}
+			else if (!load.sampleDataRequested)
+			{
+				result = bank->loadSampleData();
+				load.sampleDataRequested = true;
+
+				if (result != FMOD_OK)
+				{
+					FinishBankLoad(load, false, result);
+				}
+				else
+				{
+					done = false;
+				}
+			}
+			else
+			{
+				FMOD_STUDIO_LOADING_STATE sampleState = FMOD_STUDIO_LOADING_STATE_ERROR;
+				result = bank->getSampleLoadingState(&sampleState);
+
+				if (sampleState == FMOD_STUDIO_LOADING_STATE_LOADED)
+				{
+					FinishBankLoad(load, true, FMOD_OK);
+				}
+				else if (sampleState == FMOD_STUDIO_LOADING_STATE_LOADING)
+				{
+					done = false;
+				}
+				else
+				{
+					FinishBankLoad(load, false, result != FMOD_OK ? result : FMOD_ERR_INVALID_HANDLE);
+				}
+			}
+		}
+
+		if (!done)
+		{
+			if (kept != i)
+			{
+				pendingBankLoads[kept] = std::move(load);
+			}
+			kept++;
+		}
+	}
+
+	pendingBankLoads.resize(kept);
+}
+
+bool GetBankLoadingState(const unsigned int& index, int& loadingState, int& sampleLoadingState)
+{
+	auto bank = bankList.Get(index);
+
+	if (!bank)
+	{
+		return false;
+	}
+
+	FMOD_STUDIO_LOADING_STATE state = FMOD_STUDIO_LOADING_STATE_ERROR;
+	FMOD_STUDIO_LOADING_STATE sampleState = FMOD_STUDIO_LOADING_STATE_ERROR;
+	bank->getLoadingState(&state);
+	bank->getSampleLoadingState(&sampleState);
+
+	loadingState = static_cast<int>(state);
+	sampleLoadingState = static_cast<int>(sampleState);
+
+	return true;
+}
+
+bool LoadBankSampleData(const unsigned int& index)
+{
+	auto bank = bankList.Get(index);
+
+	if (!bank)
+	{
+		return false;
+	}
+
+	auto result = bank->loadSampleData();
+
+	return ERROR_CHECK(result);
+}
+
+bool UnloadBankSampleData(const unsigned int& index)
+{
+	auto bank = bankList.Get(index);
+
+	if (!bank)
+	{
+		return false;
+	}
+
+	auto result = bank->unloadSampleData();
+
+	return ERROR_CHECK(result);
+}
+
+// Sample data residency. Events are loaded with loadSampleData on a prefetch
+// hint or a retain, and polled every update: an event is in use while it is
+// retained or has live instances, and the least recently used idle events are
+// unloaded while the loaded total is over the budget.
+std::unordered_map<FMOD::Studio::EventDescription*, SampleResidency> sampleResidency;
+long long sampleBudget = 0;
+long long residentSampleBytes = 0;
+long long sampleLoads = 0;
+long long sampleEvictions = 0;
+
+// FMOD's heap size when it was last sampled. Growth since then is shared by
+// the loads that were in flight, see ChargeSampleHeapGrowth().
+int sampleHeapBytes = 0;
+
+void SetSampleBudget(long long bytes)
+{
+	sampleBudget = std::max(bytes, 0LL);
+}
+
+// Charges the heap growth since the last call evenly to the events whose
+// sample data is loading and that have no size hint. Each load so only pays
+// for what the heap grew while it was in flight.
+static void ChargeSampleHeapGrowth()
+{
+	int current = 0, peak = 0;
+	FMOD::Memory_GetStats(&current, &peak, false);
+
+	long long growth = std::max(current - sampleHeapBytes, 0);
+	sampleHeapBytes = current;
+
+	long long loading = 0;
+
+	for (auto& entry : sampleResidency)
+	{
+		loading += entry.second.state == RESIDENCY_LOADING;
+	}
+
+	if (loading == 0 || growth == 0)
+	{
+		return;
+	}
+
+	for (auto& entry : sampleResidency)
+	{
+		SampleResidency& residency = entry.second;
+
+		if (residency.state == RESIDENCY_LOADING && !residency.sizeHinted)
+		{
+			residency.bytes += growth / loading;
+		}
+	}
+}
+
+static SampleResidency* RequestSampleData(const char* eventPath)
+{
+	const EventInfo* eventInfo = GetEventInfo(eventPath);
+
+	if (!eventInfo)
+	{
+		return nullptr;
+	}
+
+	auto inserted = sampleResidency.emplace(eventInfo->description, SampleResidency());
+	SampleResidency& residency = inserted.first->second;
+
+	if (inserted.second)
+	{
+		residency.description = eventInfo->description;
+		residency.state = RESIDENCY_UNLOADED;
+		residency.pins = 0;
+		residency.instances = 0;
+		residency.bytes = 0;
+		residency.sizeHinted = false;
+	}
+
+	residency.lastUsed = GetClockSeconds();
+
+	if (residency.state == RESIDENCY_UNLOADED || residency.state == RESIDENCY_ERROR)
+	{
+		// Growth so far belongs to the loads already in flight.
+		ChargeSampleHeapGrowth();
+
+		if (!ERROR_CHECK(residency.description->loadSampleData()))
+		{
+			residency.state = RESIDENCY_ERROR;
+			return nullptr;
+		}
+
+		if (!residency.sizeHinted)
+		{
+			residency.bytes = 0;
+		}
+
+		residency.state = RESIDENCY_LOADING;
+		sampleLoads++;
+	}
+
+	return &residency;
+}
+
+bool PrefetchSampleData(const char* eventPath, long long bytes)
+{
+	SampleResidency* residency = RequestSampleData(eventPath);
+
+	if (!residency)
+	{
+		return false;
+	}
+
+	if (bytes > 0)
+	{
+		if (residency->state == RESIDENCY_LOADED)
+		{
+			residentSampleBytes += bytes - residency->bytes;
+		}
+
+		residency->bytes = bytes;
+		residency->sizeHinted = true;
+	}
+
+	return true;
+}
+
+bool RetainSampleData(const char* eventPath)
+{
+	SampleResidency* residency = RequestSampleData(eventPath);
+
+	if (!residency)
+	{
+		return false;
+	}
+
+	residency->pins++;
+	return true;
+}
+
+bool ReleaseSampleData(const char* eventPath)
+{
+	const EventInfo* eventInfo = GetEventInfo(eventPath);
+
+	if (!eventInfo)
+	{
+		return false;
+	}
+
+	auto found = sampleResidency.find(eventInfo->description);
+
+	if (found == sampleResidency.end() || found->second.pins == 0)
+	{
+		return false;
+	}
+
+	found->second.pins--;
+	found->second.lastUsed = GetClockSeconds();
+	return true;
+}
+
+const SampleResidency* GetSampleResidency(const char* eventPath)
+{
+	const EventInfo* eventInfo = GetEventInfo(eventPath);
+
+	if (!eventInfo)
+	{
+		return nullptr;
+	}
+
+	auto found = sampleResidency.find(eventInfo->description);
+	return found != sampleResidency.end() ? &found->second : nullptr;
+}
+
+void UpdateSampleResidency(double now)
+{
+	if (sampleResidency.empty())
+	{
+		return;
+	}
+
+	ChargeSampleHeapGrowth();
+
+	for (auto entry = sampleResidency.begin(); entry != sampleResidency.end();)
+	{
+		SampleResidency& residency = entry->second;
+
+		// Unloading the bank invalidates the description and its sample data.
+		if (!residency.description->isValid())
+		{
+			if (residency.state == RESIDENCY_LOADED)
+			{
+				residentSampleBytes -= residency.bytes;
+			}
+
+			entry = sampleResidency.erase(entry);
+			continue;
+		}
+
+		residency.instances = 0;
+		residency.description->getInstanceCount(&residency.instances);
+
+		if (residency.pins > 0 || residency.instances > 0)
+		{
+			residency.lastUsed = now;
+		}
+
+		if (residency.state == RESIDENCY_LOADING)
+		{
+			FMOD_STUDIO_LOADING_STATE state = FMOD_STUDIO_LOADING_STATE_LOADING;
+			residency.description->getSampleLoadingState(&state);
+
+			if (state == FMOD_STUDIO_LOADING_STATE_LOADED)
+			{
+				residency.state = RESIDENCY_LOADED;
+				residentSampleBytes += residency.bytes;
+			}
+			else if (state == FMOD_STUDIO_LOADING_STATE_ERROR)
+			{
+				residency.state = RESIDENCY_ERROR;
+			}
+		}
+
+		++entry;
+	}
+
+	while (sampleBudget > 0 && residentSampleBytes > sampleBudget)
+	{
+		SampleResidency* oldest = nullptr;
+
+		for (auto& entry : sampleResidency)
+		{
+			SampleResidency& residency = entry.second;
+
+			if (residency.state == RESIDENCY_LOADED && residency.pins == 0 && residency.instances == 0 &&
+				(!oldest || residency.lastUsed < oldest->lastUsed))
+			{
+				oldest = &residency;
+			}
+		}
+
+		if (!oldest)
+		{
+			break;
+		}
+
+		oldest->description->unloadSampleData();
+		oldest->state = RESIDENCY_UNLOADED;
+		residentSampleBytes -= oldest->bytes;
+		sampleEvictions++;
+	}
+}
+
+float GetBankLoadProgress(const unsigned int& index)
+{
+	auto bank = bankList.Get(index);
+
+	if (!bank)
+	{
+		return -1.f;
+	}
+
+	for (auto& load : pendingBankLoads)
+	{
+		if (load.bank == static_cast<int>(index))
+		{
+			return BankProgress(bank, load.loadSampleData);
+		}
+	}
+
+	return BankProgress(bank, false);
+}
+
+float GetLoadingProgress(int& pending)
+{
+	pending = static_cast<int>(pendingBankLoads.size());
+
+	if (asyncBankLoadsQueued == 0)
+	{
+		return 1.f;
+	}
+
+	float progress = static_cast<float>(asyncBankLoadsFinished);
+
+	for (auto& load : pendingBankLoads)
+	{
+		auto bank = bankList.Get(load.bank);
+		if (bank)
+		{
+			progress += BankProgress(bank, load.loadSampleData);
+		}
+	}
+
+	return progress / static_cast<float>(asyncBankLoadsQueued);
+}
+
+// Velocity smoothing in [0, 1): how much of the previous velocity is kept when
+// a new position comes in. 0 uses the raw velocity of the last movement.
+float motionSmoothing = 0.f;
+
+// When on, positions sent to FMOD trail the latest position by one movement
+// and slide between the last two, for games that move things in fixed ticks
+// slower than they call update.
+bool motionInterpolation = false;
+
+// Something that hasn't moved for this long is taken to be standing still.
+const double MotionTimeout = 0.2;
+
+void SetMotionSmoothing(float smoothing)
+{
+	motionSmoothing = std::min(std::max(smoothing, 0.f), 0.99f);
+}
+
+void SetMotionInterpolation(bool enabled)
+{
+	motionInterpolation = enabled;
+}
+
+static void RecordMotion(Motion& motion, const FMOD_VECTOR& position, double now, bool reset)
+{
+	if (reset)
+	{
+		motion.previous = position;
+		motion.current = position;
+		motion.velocity = FMOD_VECTOR();
+		motion.previousTime = now;
+		motion.currentTime = now;
+		return;
+	}
+
+	double elapsed = now - motion.currentTime;
+
+	// Several moves within the same instant only replace the position.
+	if (elapsed <= 0.0)
+	{
+		motion.current = position;
+		return;
+	}
+
+	float scale = static_cast<float>(1.0 / elapsed);
+	float keep = motionSmoothing;
+
+	motion.velocity.x = (position.x - motion.current.x) * scale * (1.f - keep) + motion.velocity.x * keep;
+	motion.velocity.y = (position.y - motion.current.y) * scale * (1.f - keep) + motion.velocity.y * keep;
+	motion.velocity.z = (position.z - motion.current.z) * scale * (1.f - keep) + motion.velocity.z * keep;
+
+	motion.previous = motion.current;
+	motion.previousTime = motion.currentTime;
+	motion.current = position;
+	motion.currentTime = now;
+}
+
+// Writes the position and velocity to send to FMOD now, and returns whether
+// they will still change on later updates without a new position.
+static bool SampleMotion(const Motion& motion, double now, FMOD_VECTOR& position, FMOD_VECTOR& velocity)
+{
+	bool moving = now - motion.currentTime <= MotionTimeout;
+
+	position = motion.current;
+	velocity = moving ? motion.velocity : FMOD_VECTOR();
+
+	double span = motion.currentTime - motion.previousTime;
+
+	if (motionInterpolation && span > 0.0)
+	{
+		float alpha = static_cast<float>(std::min((now - motion.currentTime) / span, 1.0));
+
+		position.x = motion.previous.x + (motion.current.x - motion.previous.x) * alpha;
+		position.y = motion.previous.y + (motion.current.y - motion.previous.y) * alpha;
+		position.z = motion.previous.z + (motion.current.z - motion.previous.z) * alpha;
+
+		// Ticks longer than MotionTimeout still have to slide all the way to
+		// the latest position.
+		moving |= alpha < 1.f;
+	}
+
+	return moving;
+}
+
+// Sends every listener that was set or is still moving to FMOD.
+void UpdateListeners(double now)
+{
+	for (int i = 0; i < numListeners; i++)
+	{
+		Listener& listener = listenerStates[i];
+
+		if (!listener.set || !(listener.dirty || listener.moving))
+		{
+			continue;
+		}
+
+		FMOD_3D_ATTRIBUTES attributes = listener.attributes;
+		listener.moving = SampleMotion(listener.motion, now, attributes.position, attributes.velocity);
+		listener.dirty = false;
+
+		ERROR_CHECK(studioSystem->setListenerAttributes(i, &attributes));
+	}
+}
+
+bool SetNumListeners(const unsigned int& listeners)
+{
+	auto result = studioSystem->setNumListeners(listeners);
+
+	if (result == FMOD_OK)
+	{
+		numListeners = std::min(static_cast<int>(listeners), MaxListeners);
+	}
+
+	return ERROR_CHECK(result);
+}
+
+bool SetListener3DPosition(const unsigned int& listener, float posX, float posY, float posZ,
+	float dirX, float dirY, float dirZ, float oX,
+	float oY, float oZ)
+{
+	Vector3 pos = Vector3(posX, posY, posZ);
+	Vector3 forward = Vector3(dirX, dirY, dirZ);
+	Vector3 up = Vector3(oX, oY, oZ);
+
+	// The attributes only reach FMOD in update, so the listener index is
+	// checked here the way setListenerAttributes would.
+	if (listener >= static_cast<unsigned int>(numListeners))
+	{
+		return ERROR_CHECK(FMOD_ERR_INVALID_PARAM);
+	}
+
+	Listener& state = listenerStates[listener];
+	To3DAttributes(pos, forward, up, state.attributes);
+	RecordMotion(state.motion, state.attributes.position, GetClockSeconds(), !state.set);
+
+	state.set = true;
+	state.dirty = true;
+
+	return true;
+}
+
+int CreateInstance(const char* eventPath)
+{
+	const EventInfo* eventInfo = GetEventInfo(eventPath);
+
+	if (eventInfo) 
+	{
+		FMOD::Studio::EventInstance* eventInstance = nullptr;
+		auto result = eventInfo->description->createInstance(&eventInstance);
+		if (result == FMOD_OK) 
+		{
+			int handle = instanceList.Add(eventInstance);
+			if (handle == -1)
+			{
+				eventInstance->release();
+			}
+			return handle;
+		}
+		else
+		{
+			return -1;
+		}		
+	}
+	else 
+	{
+		return -1;
+	}		
+}
+
+bool StartInstance(const unsigned int& index)
+{
+	auto instance = instanceList.Get(index);
+
+	if (!instance) {
+		return false;
+	}
+
+	// Recorded setters have to reach FMOD before the start they were issued
+	// ahead of.
+	FlushDeferredCommands();
+
+	if (!ERROR_CHECK(instance->start()))
+	{
+		return false;
+	}
+
+	// Only a started instance can be taken as finished once it is STOPPED.
+	auto autoRelease = autoReleaseInstances.find(index);
+
+	if (autoRelease != autoReleaseInstances.end())
+	{
+		autoRelease->second = true;
+	}
+
+	return true;
+}
+
+bool StopInstance(const unsigned int& index, int stopMode)
+{
+	auto instance = instanceList.Get(index);
+
+	if (instance) 
+	{
+		FlushDeferredCommands();
+
+		auto result = instance->stop((FMOD_STUDIO_STOP_MODE)(stopMode));
+
+		return ERROR_CHECK(result);
+	}
+
+	return false;
+}
+
+bool ReleaseInstance(const unsigned int& index)
+{
+	auto instance = instanceList.Get(index);
+
+	if (instance) 
+	{
+		FlushDeferredCommands();
+
+		auto result = instance->release();
+
+		if (result != FMOD_OK) 
+		{
+			return false;
+		}
+
+		instanceList.Remove(index);
+		autoReleaseInstances.erase(index);
+		ForgetSetterShadow(instance);
+	}
+
+	return true;
+}
+
+bool SetInstanceAutoRelease(const unsigned int& index, bool enabled)
+{
+	auto instance = instanceList.Get(index);
+
+	if (!instance)
+	{
+		return false;
+	}
+
+	if (!enabled)
+	{
+		autoReleaseInstances.erase(index);
+		return true;
+	}
+
+	FMOD_STUDIO_PLAYBACK_STATE state = FMOD_STUDIO_PLAYBACK_STOPPED;
+	instance->getPlaybackState(&state);
+
+	// An instance that is already playing counts as started. One that hasn't
+	// been started is left alone until it is, since it is also STOPPED.
+	autoReleaseInstances.emplace(index, false).first->second |= state != FMOD_STUDIO_PLAYBACK_STOPPED;
+	return true;
+}
+
+// Releases auto release instances that have been started and have stopped,
+// and frees their handles so stale copies held by Lua read as invalid.
+void ReapStoppedInstances()
+{
+	for (auto entry = autoReleaseInstances.begin(); entry != autoReleaseInstances.end();)
+	{
+		auto instance = instanceList.Get(entry->first);
+
+		if (!instance)
+		{
+			entry = autoReleaseInstances.erase(entry);
+			continue;
+		}
+
+		FMOD_STUDIO_PLAYBACK_STATE state = FMOD_STUDIO_PLAYBACK_STOPPED;
+
+		if (!entry->second || instance->getPlaybackState(&state) != FMOD_OK || state != FMOD_STUDIO_PLAYBACK_STOPPED)
+		{
+			++entry;
+			continue;
+		}
+
+		instance->release();
+		ForgetSetterShadow(instance);
+		instanceList.Remove(entry->first);
+		reapedInstances++;
+		entry = autoReleaseInstances.erase(entry);
+	}
+}
+
+bool Set3DAttributes(const unsigned int& index, float posX, float posY, float posZ, float dirX,
+	float dirY, float dirZ, float oX, float oY, float oZ)
+{
+	auto instance = instanceList.Get(index);
+
+	if (!instance) 
+	{
+		return false;
+	}
+
+	Vector3 pos = { posX, posY, posZ };
+	Vector3 forward = { dirX, dirY, dirZ };
+	Vector3 up = { oX, oY, oZ };
+
+	FMOD_3D_ATTRIBUTES attributes; To3DAttributes(pos, forward, up, attributes);
+
+	return ApplyInstance3DAttributes(instance, attributes);
+}
+
+// Applies attributes to many instances in one pass. Every vector argument is a
+// packed array of count xyz triplets; forwards, ups and velocities may be null,
+// in which case forward is +Z, up is +Y and velocity is zero. Returns the number
+// of instances that were updated; stale handles are skipped.
+int Set3DAttributesBatch(const unsigned int* indices, int count, const float* positions, const float* forwards,
+	const float* ups, const float* velocities)
+{
+	if (!indices || !positions || count <= 0)
+	{
+		return 0;
+	}
+
+	FMOD_3D_ATTRIBUTES attributes = {};
+	attributes.forward.z = 1.f;
+	attributes.up.y = 1.f;
+
+	int updated = 0;
+
+	for (int i = 0; i < count; i++)
+	{
+		auto instance = instanceList.Get(indices[i]);
+
+		if (!instance)
+		{
+			continue;
+		}
+
+		std::memcpy(&attributes.position, positions + i * 3, sizeof(FMOD_VECTOR));
+
+		if (forwards)
+		{
+			std::memcpy(&attributes.forward, forwards + i * 3, sizeof(FMOD_VECTOR));
+		}
+
+		if (ups)
+		{
+			std::memcpy(&attributes.up, ups + i * 3, sizeof(FMOD_VECTOR));
+		}
+
+		if (velocities)
+		{
+			std::memcpy(&attributes.velocity, velocities + i * 3, sizeof(FMOD_VECTOR));
+		}
+
+		if (ApplyInstance3DAttributes(instance, attributes))
+		{
+			updated++;
+		}
+	}
+
+	return updated;
+}
+
+static float DistanceSquared(const FMOD_VECTOR& a, const FMOD_VECTOR& b)
+{
+	float x = a.x - b.x;
+	float y = a.y - b.y;
+	float z = a.z - b.z;
+
+	return x * x + y * y + z * z;
+}
+
+// Emitter grid. Emitters are bucketed into cubic cells by position, in one
+// tier per reach in cells. Each update only visits the cells of a tier within
+// its reach of a listener, so emitters far from every listener cost nothing.
+// Emitters found in range are resumed and get their changed 3D attributes
+// pushed, and audible emitters that weren't found are culled.
+HandleTable<Emitter> emitterList;
+std::unordered_map<int, EmitterTier> emitterTiers;
+std::vector<Emitter*> audibleEmitters;
+float emitterCellSize = 32.f;
+unsigned int emitterFrame = 0;
+long long emitterCulls = 0;
+
+// Emitters are culled a little beyond maxDistance so one moving along the edge
+// doesn't stop and start every frame.
+const float EmitterCullMargin = 1.1f;
+
+// Cell coordinates are packed into 21 bits each.
+const int EmitterCellBits = 21;
+const int EmitterCellLimit = (1 << (EmitterCellBits - 1)) - 1;
+
+static int EmitterCellCoordinate(float value)
+{
+	float cell = std::floor(value / emitterCellSize);
+	return static_cast<int>(std::min(std::max(cell, static_cast<float>(-EmitterCellLimit)),
+		static_cast<float>(EmitterCellLimit)));
+}
+
+static std::uint64_t EmitterCellKey(int x, int y, int z)
+{
+	const std::uint64_t mask = (1ull << EmitterCellBits) - 1;
+	return ((static_cast<std::uint64_t>(x) & mask) << (EmitterCellBits * 2)) |
+		((static_cast<std::uint64_t>(y) & mask) << EmitterCellBits) | (static_cast<std::uint64_t>(z) & mask);
+}
+
+// Cells a listener has to search around it to find the emitter.
+static int EmitterReach(const Emitter* emitter)
+{
+	return static_cast<int>(std::ceil(emitter->maxDistance * EmitterCullMargin / emitterCellSize));
+}
+
+// The range of occupied cells of a tier only grows until the tier is empty.
+static void InsertEmitter(Emitter* emitter)
+{
+	const FMOD_VECTOR& position = emitter->attributes.position;
+	int cell[3] = { EmitterCellCoordinate(position.x), EmitterCellCoordinate(position.y),
+		EmitterCellCoordinate(position.z) };
+
+	EmitterTier& tier = emitterTiers[emitter->reach];
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		tier.cellMin[axis] = tier.count == 0 ? cell[axis] : std::min(tier.cellMin[axis], cell[axis]);
+		tier.cellMax[axis] = tier.count == 0 ? cell[axis] : std::max(tier.cellMax[axis], cell[axis]);
+	}
+
+	tier.count++;
+	emitter->cell = EmitterCellKey(cell[0], cell[1], cell[2]);
+	tier.grid[emitter->cell].push_back(emitter);
+}
+
+static void RemoveEmitterFromCell(Emitter* emitter)
+{
+	auto tier = emitterTiers.find(emitter->reach);
+
+	if (tier == emitterTiers.end())
+	{
+		return;
+	}
+
+	auto found = tier->second.grid.find(emitter->cell);
+
+	if (found == tier->second.grid.end())
+	{
+		return;
+	}
+
+	auto& bucket = found->second;
+	auto entry = std::find(bucket.begin(), bucket.end(), emitter);
+
+	if (entry != bucket.end())
+	{
+		*entry = bucket.back();
+		bucket.pop_back();
+		tier->second.count--;
+	}
+
+	if (bucket.empty())
+	{
+		tier->second.grid.erase(found);
+	}
+
+	if (tier->second.count == 0)
+	{
+		emitterTiers.erase(tier);
+	}
+}
+
+int CreateEmitter(const unsigned int& instanceIndex, const FMOD_3D_ATTRIBUTES& attributes, float maxDistance,
+	EmitterCullMode cullMode)
+{
+	auto instance = instanceList.Get(instanceIndex);
+	FMOD::Studio::EventDescription* description = nullptr;
+
+	if (!instance || instance->getDescription(&description) != FMOD_OK)
+	{
+		return -1;
+	}
+
+	int length = 0;
+	description->getLength(&length);
+
+	bool oneShot = false;
+	description->isOneshot(&oneShot);
+
+	if (maxDistance <= 0.f)
+	{
+		float minDistance = 0.f;
+		description->getMinMaxDistance(&minDistance, &maxDistance);
+	}
+
+	auto emitter = new Emitter();
+	int handle = emitterList.Add(emitter);
+
+	if (handle < 0)
+	{
+		delete emitter;
+		return -1;
+	}
+
+	emitter->instance = instanceIndex;
+	emitter->attributes = attributes;
+	emitter->moving = false;
+	RecordMotion(emitter->motion, attributes.position, GetClockSeconds(), true);
+	emitter->maxDistance = maxDistance;
+	emitter->cullMode = cullMode;
+	emitter->audible = false;
+	emitter->dirty = true;
+	emitter->length = length;
+	emitter->oneShot = oneShot;
+	emitter->finished = false;
+	emitter->culledPosition = -1;
+	emitter->culledAt = 0.0;
+	emitter->frame = emitterFrame;
+	emitter->reach = EmitterReach(emitter);
+
+	InsertEmitter(emitter);
+
+	// Culling stops the instance, which auto release would take as finished.
+	autoReleaseInstances.erase(instanceIndex);
+
+	return handle;
+}
+
+static void MoveEmitter(Emitter* emitter, const FMOD_VECTOR& position, double now)
+{
+	std::uint64_t cell = EmitterCellKey(EmitterCellCoordinate(position.x), EmitterCellCoordinate(position.y),
+		EmitterCellCoordinate(position.z));
+
+	if (cell != emitter->cell)
+	{
+		RemoveEmitterFromCell(emitter);
+		emitter->attributes.position = position;
+		InsertEmitter(emitter);
+	}
+	else
+	{
+		emitter->attributes.position = position;
+	}
+
+	RecordMotion(emitter->motion, position, now, false);
+	emitter->dirty = true;
+}
+
+// Moves count emitters to the packed xyz positions. Their velocity is derived
+// from the movement. Returns the number of emitters moved.
+int SetEmitterPositions(const unsigned int* emitterIndices, int count, const float* positions)
+{
+	if (!emitterIndices || !positions)
+	{
+		return 0;
+	}
+
+	double now = GetClockSeconds();
+	int updated = 0;
+
+	for (int i = 0; i < count; i++)
+	{
+		auto emitter = emitterList.Get(emitterIndices[i]);
+
+		if (!emitter)
+		{
+			continue;
+		}
+
+		FMOD_VECTOR position;
+		std::memcpy(&position, positions + i * 3, sizeof(FMOD_VECTOR));
+		MoveEmitter(emitter, position, now);
+		updated++;
+	}
+
+	return updated;
+}
+
+// Stops the emitter's instance and removes the emitter. The instance itself
+// stays valid for the caller to release.
+bool ReleaseEmitter(const unsigned int& emitterIndex)
+{
+	auto emitter = emitterList.Get(emitterIndex);
+
+	if (!emitter)
+	{
+		return false;
+	}
+
+	auto instance = instanceList.Get(emitter->instance);
+
+	if (instance && emitter->audible)
+	{
+		instance->stop(FMOD_STUDIO_STOP_ALLOWFADEOUT);
+	}
+
+	auto audible = std::find(audibleEmitters.begin(), audibleEmitters.end(), emitter);
+
+	if (audible != audibleEmitters.end())
+	{
+		*audible = audibleEmitters.back();
+		audibleEmitters.pop_back();
+	}
+
+	RemoveEmitterFromCell(emitter);
+	emitterList.Remove(emitterIndex);
+	delete emitter;
+
+	return true;
+}
+
+bool IsEmitterAudible(const unsigned int& emitterIndex)
+{
+	auto emitter = emitterList.Get(emitterIndex);
+	return emitter && emitter->audible;
+}
+
+void SetEmitterCellSize(float cellSize)
+{
+	if (cellSize <= 0.f || cellSize == emitterCellSize)
+	{
+		return;
+	}
+
+	emitterCellSize = cellSize;
+
+	std::vector<Emitter*> emitters;
+
+	for (auto& tier : emitterTiers)
+	{
+		for (auto& cell : tier.second.grid)
+		{
+			emitters.insert(emitters.end(), cell.second.begin(), cell.second.end());
+		}
+	}
+
+	emitterTiers.clear();
+
+	for (auto emitter : emitters)
+	{
+		emitter->reach = EmitterReach(emitter);
+		InsertEmitter(emitter);
+	}
+}
+
+static void PushEmitterAttributes(Emitter* emitter, FMOD::Studio::EventInstance* instance, double now)
+{
+	FMOD_3D_ATTRIBUTES attributes = emitter->attributes;
+	emitter->moving = SampleMotion(emitter->motion, now, attributes.position, attributes.velocity);
+	emitter->dirty = false;
+
+	instance->set3DAttributes(&attributes);
+}
+
+// Brings an emitter back into range: pushes its attributes, then starts or
+// unpauses it and moves the timeline on by the time it was out of range. Only
+// looping events wrap around; a one-shot that would have ended by now is
+// left stopped for good.
+static void ResumeEmitter(Emitter* emitter, FMOD::Studio::EventInstance* instance, double now)
+{
+	emitter->audible = true;
+	PushEmitterAttributes(emitter, instance, now);
+
+	if (emitter->finished)
+	{
+		return;
+	}
+
+	long long position = -1;
+
+	if (emitter->culledPosition >= 0 && emitter->length > 0)
+	{
+		position = emitter->culledPosition + static_cast<long long>((now - emitter->culledAt) * 1000.0);
+
+		if (emitter->oneShot && position >= emitter->length)
+		{
+			emitter->finished = true;
+			instance->stop(FMOD_STUDIO_STOP_IMMEDIATE);
+			return;
+		}
+
+		position %= emitter->length;
+	}
+
+	if (emitter->cullMode == EMITTER_CULL_PAUSE)
+	{
+		instance->setPaused(false);
+	}
+	else
+	{
+		instance->start();
+	}
+
+	if (position >= 0)
+	{
+		instance->setTimelinePosition(static_cast<int>(position));
+	}
+}
+
+static void CullEmitter(Emitter* emitter, FMOD::Studio::EventInstance* instance, double now)
+{
+	emitter->audible = false;
+	emitter->culledAt = now;
+	emitterCulls++;
+
+	if (emitter->finished)
+	{
+		return;
+	}
+
+	// A one-shot that already played to its end while in range stays done.
+	FMOD_STUDIO_PLAYBACK_STATE state = FMOD_STUDIO_PLAYBACK_STOPPED;
+
+	if (instance && emitter->oneShot && instance->getPlaybackState(&state) == FMOD_OK &&
+		state == FMOD_STUDIO_PLAYBACK_STOPPED)
+	{
+		emitter->finished = true;
+		return;
+	}
+
+	if (!instance || instance->getTimelinePosition(&emitter->culledPosition) != FMOD_OK)
+	{
+		emitter->culledPosition = -1;
+	}
+
+	if (!instance)
+	{
+		return;
+	}
+
+	if (emitter->cullMode == EMITTER_CULL_PAUSE)
+	{
+		instance->setPaused(true);
+	}
+	else
+	{
+		instance->stop(FMOD_STUDIO_STOP_IMMEDIATE);
+	}
+}
+
+void UpdateEmitters(double now)
+{
+	if (emitterList.Size() == 0)
+	{
+		return;
+	}
+
+	emitterFrame++;
+
+	for (auto& entry : emitterTiers)
+	{
+		int reach = entry.first;
+		EmitterTier& tier = entry.second;
+
+		for (int listener = 0; listener < numListeners; listener++)
+		{
+			const FMOD_VECTOR& origin = listenerStates[listener].attributes.position;
+			int center[3] = { EmitterCellCoordinate(origin.x), EmitterCellCoordinate(origin.y),
+				EmitterCellCoordinate(origin.z) };
+			int low[3], high[3];
+
+			for (int axis = 0; axis < 3; axis++)
+			{
+				low[axis] = std::max(center[axis] - reach, tier.cellMin[axis]);
+				high[axis] = std::min(center[axis] + reach, tier.cellMax[axis]);
+			}
+
+			for (int x = low[0]; x <= high[0]; x++)
+			for (int y = low[1]; y <= high[1]; y++)
+			for (int z = low[2]; z <= high[2]; z++)
+			{
+				auto cell = tier.grid.find(EmitterCellKey(x, y, z));
+
+				if (cell == tier.grid.end())
+				{
+					continue;
+				}
+
+				for (auto emitter : cell->second)
+				{
+					if (emitter->frame == emitterFrame)
+					{
+						continue;
+					}
+
+					float dx = emitter->attributes.position.x - origin.x;
+					float dy = emitter->attributes.position.y - origin.y;
+					float dz = emitter->attributes.position.z - origin.z;
+					float limit = emitter->audible ? emitter->maxDistance * EmitterCullMargin : emitter->maxDistance;
+
+					if (dx * dx + dy * dy + dz * dz > limit * limit)
+					{
+						continue;
+					}
+
+					emitter->frame = emitterFrame;
+
+					if (!emitter->audible)
+					{
+						auto instance = instanceList.Get(emitter->instance);
+
+						if (instance)
+						{
+							ResumeEmitter(emitter, instance, now);
+							audibleEmitters.push_back(emitter);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	for (std::size_t i = 0; i < audibleEmitters.size();)
+	{
+		Emitter* emitter = audibleEmitters[i];
+		auto instance = instanceList.Get(emitter->instance);
+
+		if (!instance || emitter->frame != emitterFrame)
+		{
+			CullEmitter(emitter, instance, now);
+			audibleEmitters[i] = audibleEmitters.back();
+			audibleEmitters.pop_back();
+			continue;
+		}
+
+		if (emitter->dirty || emitter->moving)
+		{
+			PushEmitterAttributes(emitter, instance, now);
+		}
+
+		i++;
+	}
+}
+
+// In offline mode time is the length of audio rendered so far, so that
+// timing based features behave the same however fast the render runs.
+double GetClockSeconds()
+{
+	if (IsOffline())
+	{
+		return offlineCapture.clock;
+	}
+
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+static OneShotPolicy* GetOneShotPolicy(const char* eventPath)
+{
+	if (!eventPath)
+	{
+		return nullptr;
+	}
+
+	auto found = oneShotPolicies.find(eventPath);
+
+	if (found == oneShotPolicies.end())
+	{
+		OneShotPolicy policy = {};
+		policy.path = eventPath;
+		found = oneShotPolicies.emplace(policy.path, std::move(policy)).first;
+
+		// Link the new policy into the cached event, if it was resolved already.
+		auto cached = eventCache.find(std::string_view(found->first));
+		if (cached != eventCache.end())
+		{
+			cached->second->info.policy = &found->second;
+		}
+	}
+
+	return &found->second;
+}
+
+bool SetOneShotCoalescing(const char* eventPath, float radius, float windowMs, const char* countParameterName)
+{
+	const EventInfo* eventInfo = GetEventInfo(eventPath);
+
+	if (!eventInfo)
+	{
+		return false;
+	}
+
+	OneShotPolicy* policy = GetOneShotPolicy(eventPath);
+	policy->coalesce = radius >= 0.f;
+	policy->radius = radius;
+	policy->window = std::max(windowMs, 0.f) / 1000.0;
+	policy->hasCountParameter = false;
+
+	if (countParameterName)
+	{
+		FMOD_STUDIO_PARAMETER_DESCRIPTION parameterDescription;
+		auto result = eventInfo->description->getParameterDescriptionByName(countParameterName, &parameterDescription);
+
+		if (result != FMOD_OK)
+		{
+			return false;
+		}
+
+		policy->hasCountParameter = true;
+		policy->countParameter = parameterDescription.id;
+	}
+
+	return true;
+}
+
+bool SetOneShotRateLimit(const char* eventPath, int maxStarts, float periodMs)
+{
+	if (!GetEventInfo(eventPath))
+	{
+		return false;
+	}
+
+	OneShotPolicy* policy = GetOneShotPolicy(eventPath);
+	policy->maxStarts = std::max(maxStarts, 0);
+	policy->period = std::max(periodMs, 0.f) / 1000.0;
+	policy->starts.assign(policy->maxStarts, -policy->period);
+	policy->nextStart = 0;
+
+	return true;
+}
+
+// Records a start against the policy's rate limit. The start times live in a
+// ring of maxStarts entries, so the slot about to be overwritten holds the
+// oldest start: if that one is still inside the period the limit is reached.
+static bool ConsumeOneShotStart(OneShotPolicy* policy, double now)
+{
+	if (policy->maxStarts == 0)
+	{
+		return true;
+	}
+
+	double& oldest = policy->starts[policy->nextStart];
+
+	if (now - oldest < policy->period)
+	{
+		return false;
+	}
+
+	oldest = now;
+	policy->nextStart = (policy->nextStart + 1) % policy->starts.size();
+
+	return true;
+}
+
+static bool StartOneShot(const EventInfo* eventInfo, const FMOD_3D_ATTRIBUTES* attributes, int count,
+	FMOD::Studio::EventInstance** outInstance)
+{
+	FMOD::Studio::EventInstance* eventInstance = nullptr;
+	auto result = eventInfo->description->createInstance(&eventInstance);
+
+	if (result != FMOD_OK)
+	{
+		return false;
+	}
+
+	if (attributes)
+	{
+		eventInstance->set3DAttributes(attributes);
+	}
+
+	OneShotPolicy* policy = eventInfo->policy;
+	if (policy && policy->hasCountParameter)
+	{
+		eventInstance->setParameterByID(policy->countParameter, static_cast<float>(count), true);
+	}
+
+	eventInstance->start();
+	eventInstance->release();
+
+	if (outInstance)
+	{
+		*outInstance = eventInstance;
+	}
+
+	return true;
+}
+
+static void FlushOneShotPolicy(OneShotPolicy* policy, double now)
+{
+	auto& recent = policy->recent;
+
+	recent.erase(std::remove_if(recent.begin(), recent.end(), [&](const RecentOneShot& r) {
+		return now - r.startTime > policy->window;
+	}), recent.end());
+
+	if (policy->pending.empty())
+	{
+		return;
+	}
+
+	const EventInfo* eventInfo = GetEventInfo(policy->path.c_str());
+
+	if (!eventInfo)
+	{
+		policy->pending.clear();
+		return;
+	}
+
+	float radiusSquared = policy->radius * policy->radius;
+	std::size_t recentCount = recent.size();
+
+	// Merge every request into a one-shot that is still inside the window, or
+	// into a cluster formed earlier in this flush. Only clusters need new
+	// instances; clusters are appended to recent so they merge the same way.
+	for (auto& request : policy->pending)
+	{
+		bool merged = false;
+
+		for (auto& r : recent)
+		{
+			if (DistanceSquared(r.attributes.position, request.attributes.position) <= radiusSquared)
+			{
+				r.count += request.count;
+				r.dirty = true;
+				merged = true;
+				break;
+			}
+		}
+
+		if (!merged)
+		{
+			recent.push_back({ request.attributes, nullptr, now, request.count, false });
+		}
+	}
+
+	policy->pending.clear();
+
+	for (std::size_t i = 0; i < recentCount; i++)
+	{
+		RecentOneShot& r = recent[i];
+
+		if (r.dirty && r.instance && policy->hasCountParameter)
+		{
+			r.instance->setParameterByID(policy->countParameter, static_cast<float>(r.count), true);
+		}
+
+		r.dirty = false;
+	}
+
+	for (std::size_t i = recentCount; i < recent.size(); i++)
+	{
+		RecentOneShot& r = recent[i];
+		r.dirty = false;
+
+		if (ConsumeOneShotStart(policy, now))
+		{
+			StartOneShot(eventInfo, eventInfo->is3D ? &r.attributes : nullptr, r.count, &r.instance);
+		}
+	}
+
+	// Clusters that were rate limited or failed to start are dropped, so later
+	// requests nearby get their own chance instead of merging into silence.
+	recent.erase(std::remove_if(recent.begin() + recentCount, recent.end(), [](const RecentOneShot& r) {
+		return !r.instance;
+	}), recent.end());
+}
+
+void FlushOneShots(double now)
+{
+	for (auto& entry : oneShotPolicies)
+	{
+		FlushOneShotPolicy(&entry.second, now);
+	}
+}
+
+// Applies the event's one-shot policy to a request. Returns true if the
+// request was handled (queued or dropped by the rate limit), false if it should
+// be played right away. played reports whether the request will be heard.
+static bool ApplyOneShotPolicy(const EventInfo* eventInfo, const FMOD_3D_ATTRIBUTES& attributes, bool& played)
+{
+	OneShotPolicy* policy = eventInfo->policy;
+
+	if (!policy)
+	{
+		return false;
+	}
+
+	if (policy->coalesce)
+	{
+		policy->pending.push_back({ attributes, 1 });
+		played = true;
+		return true;
+	}
+
+	if (!ConsumeOneShotStart(policy, GetClockSeconds()))
+	{
+		played = false;
+		return true;
+	}
+
+	return false;
+}
+
+bool PlayOneShot2D(const char* eventPath)
+{
+	const EventInfo* eventInfo = GetEventInfo(eventPath);
+
+	if (eventInfo) 
+	{
+		bool played = false;
+		FMOD_3D_ATTRIBUTES attributes = {};
+
+		if (ApplyOneShotPolicy(eventInfo, attributes, played))
+		{
+			return played;
+		}
+
+		FMOD::Studio::EventInstance* eventInstance = NULL;
+		eventInfo->description->createInstance(&eventInstance);
+
+		if (eventInstance) 
+		{
+			eventInstance->start();
+			eventInstance->release();
+			return true;
+		}
+		else
+			return false;
+	}
+	else
+		return false;
+}
+
+bool PlayOneShot3D(const char* eventPath, float posX, float posY, float posZ,
+	float dirX, float dirY, float dirZ, float oX, float oY,
+	float oZ)
+{
+	const EventInfo* eventInfo = GetEventInfo(eventPath);
+
+	if (eventInfo) 
+	{
+		if (!eventInfo->is3D) {
+			return false;
+		}
+
+		Vector3 pos = { posX, posY, posZ };
+		Vector3 forward = { dirX, dirY, dirZ };
+		Vector3 up = { oX, oY, oZ };
+
+		FMOD_3D_ATTRIBUTES attributes; To3DAttributes(pos, forward, up, attributes);
+
+		bool played = false;
+
+		if (ApplyOneShotPolicy(eventInfo, attributes, played))
+		{
+			return played;
+		}
+
+		FMOD::Studio::EventInstance* eventInstance = NULL;
+		auto result = eventInfo->description->createInstance(&eventInstance);
+
+		if (result != FMOD_OK) 
+		{
+			return false;
+		}
+
+		eventInstance->set3DAttributes(&attributes);
+		eventInstance->start();
+		eventInstance->release();
+
+		return true;
+	}
+	else
+		return false;
+}
+
+InstancePool* CreatePool(const char* eventPath, int size, PoolStealMode stealMode)
+{
+	const EventInfo* eventInfo = GetEventInfo(eventPath);
+
+	if (!eventInfo || size <= 0)
+	{
+		return nullptr;
+	}
+
+	auto pool = new InstancePool();
+	pool->description = eventInfo->description;
+	pool->is3D = eventInfo->is3D;
+	pool->stealMode = stealMode;
+	pool->playCount = 0;
+
+	// Load the samples now as well, otherwise the first play still has to wait
+	// for them. ReleasePool() drops this reference again.
+	pool->sampleDataLoaded = pool->description->loadSampleData() == FMOD_OK;
+
+	for (int i = 0; i < size; i++)
+	{
+		FMOD::Studio::EventInstance* eventInstance = nullptr;
+		auto result = pool->description->createInstance(&eventInstance);
+
+		if (result != FMOD_OK)
+		{
+			ReleasePool(pool);
+			return nullptr;
+		}
+
+		pool->instances.push_back(eventInstance);
+		pool->startedAt.push_back(0);
+		pool->positions.push_back({ 0.f, 0.f, 0.f });
+	}
+
+	return pool;
+}
+
+// Picks the instance to play next: the first stopped one if there is any,
+// otherwise the voice chosen by the pool's steal mode.
+static std::size_t PickPoolInstance(InstancePool* pool)
+{
+	std::size_t count = pool->instances.size();
+
+	for (std::size_t i = 0; i < count; i++)
+	{
+		FMOD_STUDIO_PLAYBACK_STATE state = FMOD_STUDIO_PLAYBACK_STOPPED;
+		pool->instances[i]->getPlaybackState(&state);
+
+		if (state == FMOD_STUDIO_PLAYBACK_STOPPED)
+		{
+			return i;
+		}
+	}
+
+	std::size_t victim = 0;
+
+	if (pool->stealMode == POOL_STEAL_FARTHEST && pool->is3D)
+	{
+		FMOD_3D_ATTRIBUTES listener = {};
+		studioSystem->getListenerAttributes(0, &listener);
+
+		float farthest = -1.f;
+
+		for (std::size_t i = 0; i < count; i++)
+		{
+			float distance = DistanceSquared(pool->positions[i], listener.position);
+
+			if (distance > farthest)
+			{
+				farthest = distance;
+				victim = i;
+			}
+		}
+	}
+	else
+	{
+		for (std::size_t i = 1; i < count; i++)
+		{
+			if (pool->startedAt[i] < pool->startedAt[victim])
+			{
+				victim = i;
+			}
+		}
+	}
+
+	return victim;
+}
+
+bool PlayPool(InstancePool* pool, const FMOD_3D_ATTRIBUTES& attributes)
+{
+	if (!pool || pool->instances.empty())
+	{
+		return false;
+	}
+
+	std::size_t i = PickPoolInstance(pool);
+	auto instance = pool->instances[i];
+
+	if (pool->is3D)
+	{
+		instance->set3DAttributes(&attributes);
+		pool->positions[i] = attributes.position;
+	}
+
+	// start() on an instance that is still playing restarts it, which is
+	// exactly what stealing the voice needs.
+	auto result = instance->start();
+
+	if (result != FMOD_OK)
+	{
+		return false;
+	}
+
+	pool->startedAt[i] = ++pool->playCount;
+
+	return true;
+}
+
+int GetPoolActiveCount(InstancePool* pool)
+{
+	if (!pool)
+	{
+		return -1;
+	}
+
+	int active = 0;
+
+	for (auto instance : pool->instances)
+	{
+		FMOD_STUDIO_PLAYBACK_STATE state = FMOD_STUDIO_PLAYBACK_STOPPED;
+		instance->getPlaybackState(&state);
+
+		if (state != FMOD_STUDIO_PLAYBACK_STOPPED)
+		{
+			active++;
+		}
+	}
+
+	return active;
+}
+
+bool StopPool(InstancePool* pool, int stopMode)
+{
+	if (!pool)
+	{
+		return false;
+	}
+
+	bool stopped = true;
+
+	for (auto instance : pool->instances)
+	{
+		stopped &= ERROR_CHECK(instance->stop((FMOD_STUDIO_STOP_MODE)(stopMode)));
+	}
+
+	return stopped;
+}
+
+void ReleasePool(InstancePool* pool)
+{
+	if (!pool)
+	{
+		return;
+	}
+
+	FlushDeferredCommands();
+
+	for (auto instance : pool->instances)
+	{
+		ForgetSetterShadow(instance);
+		instance->release();
+	}
+
+	if (pool->sampleDataLoaded)
+	{
+		pool->description->unloadSampleData();
+	}
+
+	delete pool;
+}
+
+bool SetInstanceVolume(const unsigned int& index, float volume)
+{
+	auto instance = instanceList.Get(index);
+
+	if (!instance) 
+	{
+		return false;
+	}
+
+	return ApplyInstanceVolume(instance, volume);
+}
+
+bool IsPlaying(const unsigned int& index)
+{
+	auto instance = instanceList.Get(index);
+
+	if (!instance) 
+	{
+		return false;
+	}
+
+	return InstanceIsPlaying(instance);
+}
+
+static bool InstanceIsPlaying(FMOD::Studio::EventInstance* instance)
+{
+	FMOD_STUDIO_PLAYBACK_STATE pS = FMOD_STUDIO_PLAYBACK_STATE::FMOD_STUDIO_PLAYBACK_STOPPED;
+
+	auto result = instance->getPlaybackState(&pS);
+
+	if (result != FMOD_OK) 
+	{
+		return false;
+	}
+
+	if (pS == FMOD_STUDIO_PLAYBACK_PLAYING) 
+	{
+		return true;
+	}
+	else
+	{
+		return false;
+	}	
+}
+
+bool SetInstancePaused(const unsigned int& index, bool pause)
+{
+	auto instance = instanceList.Get(index);
+
+	if (!instance) 
+	{
+		return false;
+	}
+
+	return ApplyInstancePaused(instance, pause);
+}
+
+bool SetInstancePitch(const unsigned int& index, float pitch)
+{
+	auto instance = instanceList.Get(index);
+
+	if (!instance)
+	{
+		return false;
+	}
+
+	return ApplyInstancePitch(instance, pitch);
+}
+
+float GetInstancePitch(const unsigned int& index)
+{
+	auto instance = instanceList.Get(index);
+
+	if (!instance) 
+	{
+		return -1.f;
+	}
+
+	float pitch = 0;
+	float finalPitch = 0;
+
+	auto result = instance->getPitch(&pitch, &finalPitch);
+
+	if (result != FMOD_OK) 
+	{
+		return -1.f;
+	}
+
+	return finalPitch;
+}
+
+int GetTimelinePosition(const unsigned int& index)
+{
+	auto instance = instanceList.Get(index);
+
+	if (!instance) 
+	{
+		return -1;
+	}
+
+	int position = 0;
+
+	auto result = instance->getTimelinePosition(&position);
+
+	if (result != FMOD_OK) 
+	{
+		return -1;
+	}
+
+	return position;
+}
+
+bool SetTimelinePosition(const unsigned int& index, const unsigned int& position)
+{
+	auto instance = instanceList.Get(index);
+
+	if (!instance) 
+	{
+		return false;
+	}
+
+	return ApplyTimelinePosition(instance, position);
+}
+
+float GetInstanceRMS(const unsigned int& index)
+{
+	auto instance = instanceList.Get(index);
+
+	if (!instance) 
+	{
+		return -1;
+	}
+
+	return InstanceRMS(instance);
+}
+
+static float InstanceRMS(FMOD::Studio::EventInstance* instance)
+{
+	FMOD::ChannelGroup* ChanGroup = nullptr;
+	instance->getChannelGroup(&ChanGroup);
+	if (ChanGroup) 
+	{
+		FMOD::DSP* ChanDSP = nullptr;
+		ChanGroup->getDSP(0, &ChanDSP);
+		if (ChanDSP) 
+		{
+			ChanDSP->setMeteringEnabled(false, true);
+			FMOD_DSP_METERING_INFO Info = {};
+			ChanDSP->getMeteringInfo(nullptr, &Info);
+
+			float rms = 0.f;
+
+			for (int i = 0; i < Info.numchannels; i++) 
+			{
+				rms += Info.rmslevel[i] * Info.rmslevel[i];
+			}
+
+			rms = std::sqrt(rms / (float)Info.numchannels);
+
+			float dB = rms > 0 ? 20.0f * std::log10(rms * std::sqrt(2.0f)) : -80.0f;
+			if (dB > 10.0f)
+				dB = 10.0f;
+			return dB;
+		}
+		else
+			return -1.f;
+	}
+	else
+		return -1.f;
+}
+
+// Metering registry. Meters are registered once and all of them are read in
+// a single pass from Update(): the linear RMS and peak of every target are
+// gathered into dense arrays, then converted to dB in one vectorised sweep so
+// reading a level is just an array lookup.
+HandleTable<Meter> meterList;
+std::vector<Meter*> meters;
+std::vector<float> meterRms;
+std::vector<float> meterPeak;
+std::vector<float> meterRmsDecibels;
+std::vector<float> meterPeakDecibels;
+
+// Keeps the logarithm finite. Silence is clamped to -80 dB after the RMS
+// offset has been added, so this sits well below that.
+const float MeterFloor = 1e-6f;
+const float MeterFloorDecibels = -80.f;
+const float MeterCeilingDecibels = 10.f;
+
+// dB of a sine with the same RMS as a full scale peak, as in InstanceRMS().
+const float MeterRmsOffsetDecibels = 3.0103f;
+
+static FMOD::DSP* MeterDSP(MeterTargetType type, void* target)
+{
+	FMOD::ChannelGroup* group = nullptr;
+
+	if (type == METER_INSTANCE)
+	{
+		static_cast<FMOD::Studio::EventInstance*>(target)->getChannelGroup(&group);
+	}
+	else
+	{
+		static_cast<FMOD::Studio::Bus*>(target)->getChannelGroup(&group);
+	}
+
+	FMOD::DSP* dsp = nullptr;
+
+	if (group)
+	{
+		group->getDSP(0, &dsp);
+	}
+
+	return dsp;
+}
+
+static int AddMeter(MeterTargetType type, void* target)
+{
+	auto meter = new Meter();
+	int handle = meterList.Add(meter);
+
+	if (handle < 0)
+	{
+		delete meter;
+		return -1;
+	}
+
+	meter->type = type;
+	meter->target = target;
+	meter->dsp = MeterDSP(type, target);
+	meter->slot = static_cast<unsigned int>(meters.size());
+	meter->handle = static_cast<unsigned int>(handle);
+
+	meters.push_back(meter);
+	meterRms.push_back(0.f);
+	meterPeak.push_back(0.f);
+	meterRmsDecibels.push_back(MeterFloorDecibels);
+	meterPeakDecibels.push_back(MeterFloorDecibels);
+
+	// Enable metering now so the first update already has a reading.
+	if (meter->dsp)
+	{
+		meter->dsp->setMeteringEnabled(false, true);
+	}
+
+	return handle;
+}
+
+int AddInstanceMeter(FMOD::Studio::EventInstance* instance)
+{
+	if (!instance || !instance->isValid())
+	{
+		return -1;
+	}
+
+	return AddMeter(METER_INSTANCE, instance);
+}
+
+int AddBusMeter(const unsigned int& busIndex)
+{
+	auto bus = busList.Get(busIndex);
+
+	// A bus only has a channel group while something is routed through it,
+	// unless it is locked.
+	if (!bus || !ERROR_CHECK(bus->lockChannelGroup()))
+	{
+		return -1;
+	}
+
+	return AddMeter(METER_BUS, bus);
+}
+
+bool RemoveMeter(const unsigned int& meterIndex)
+{
+	auto meter = meterList.Get(meterIndex);
+
+	if (!meter)
+	{
+		return false;
+	}
+
+	if (meter->type == METER_BUS)
+	{
+		static_cast<FMOD::Studio::Bus*>(meter->target)->unlockChannelGroup();
+	}
+
+	// Swap the last meter into the freed slot so the level arrays stay dense.
+	unsigned int slot = meter->slot;
+	Meter* last = meters.back();
+
+	meters[slot] = last;
+	meterRms[slot] = meterRms.back();
+	meterPeak[slot] = meterPeak.back();
+	meterRmsDecibels[slot] = meterRmsDecibels.back();
+	meterPeakDecibels[slot] = meterPeakDecibels.back();
+	last->slot = slot;
+
+	meters.pop_back();
+	meterRms.pop_back();
+	meterPeak.pop_back();
+	meterRmsDecibels.pop_back();
+	meterPeakDecibels.pop_back();
+
+	meterList.Remove(meterIndex);
+	delete meter;
+
+	return true;
+}
+
+// Returns false once the meter's instance or bus is no longer valid.
+static bool ReadMeter(Meter* meter)
+{
+	bool valid = meter->type == METER_INSTANCE
+		? static_cast<FMOD::Studio::EventInstance*>(meter->target)->isValid()
+		: static_cast<FMOD::Studio::Bus*>(meter->target)->isValid();
+
+	if (!valid)
+	{
+		return false;
+	}
+
+	FMOD::DSP* dsp = MeterDSP(meter->type, meter->target);
+	FMOD_DSP_METERING_INFO info = {};
+
+	if (dsp && dsp != meter->dsp)
+	{
+		dsp->setMeteringEnabled(false, true);
+		meter->dsp = dsp;
+	}
+
+	if (dsp)
+	{
+		dsp->getMeteringInfo(nullptr, &info);
+	}
+
+	float sum = 0.f;
+	float peak = 0.f;
+
+	for (int i = 0; i < info.numchannels; i++)
+	{
+		sum += info.rmslevel[i] * info.rmslevel[i];
+		peak = std::max(peak, info.peaklevel[i]);
+	}
+
+	meterRms[meter->slot] = info.numchannels > 0 ? std::sqrt(sum / info.numchannels) : 0.f;
+	meterPeak[meter->slot] = peak;
+
+	return true;
+}
+
+void UpdateMeters()
+{
+	if (meters.empty())
+	{
+		return;
+	}
+
+	// Meters on released instances are dropped here. RemoveMeter() swaps the
+	// last meter into the freed slot, so that slot is read again.
+	for (size_t i = 0; i < meters.size();)
+	{
+		if (ReadMeter(meters[i]))
+		{
+			i++;
+		}
+		else
+		{
+			RemoveMeter(meters[i]->handle);
+		}
+	}
+
+	int count = static_cast<int>(meters.size());
+	LevelsToDecibels(meterRms.data(), meterRmsDecibels.data(), count, MeterRmsOffsetDecibels);
+	LevelsToDecibels(meterPeak.data(), meterPeakDecibels.data(), count, 0.f);
+}
+
+// 20 * log10(level) + offset, clamped to [-80, 10] dB. The logarithm splits
+// the float into exponent and mantissa m in [1, 2) and evaluates ln(m) with
+// the series 2 * atanh((m - 1) / (m + 1)), which is accurate to about 1e-4 dB.
+// The SSE2 and scalar paths do the same arithmetic.
+void LevelsToDecibels(const float* levels, float* decibels, int count, float offset)
+{
+	const float ln2 = 0.69314718f;
+	const float decibelsPerNeper = 8.68588964f;
+
+	int i = 0;
+
+#ifdef FMODLOVE_SSE2
+	const __m128 floor = _mm_set1_ps(MeterFloor);
+	const __m128 one = _mm_set1_ps(1.f);
+	const __m128i mantissaMask = _mm_set1_epi32(0x007FFFFF);
+	const __m128i exponentOne = _mm_set1_epi32(0x3F800000);
+	const __m128i exponentBias = _mm_set1_epi32(127);
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 level = _mm_max_ps(_mm_loadu_ps(levels + i), floor);
+		__m128i bits = _mm_castps_si128(level);
+
+		__m128 exponent = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), exponentBias));
+		__m128 mantissa = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, mantissaMask), exponentOne));
+
+		__m128 t = _mm_div_ps(_mm_sub_ps(mantissa, one), _mm_add_ps(mantissa, one));
+		__m128 t2 = _mm_mul_ps(t, t);
+		__m128 series = _mm_add_ps(_mm_set1_ps(2.f / 5.f), _mm_mul_ps(t2, _mm_set1_ps(2.f / 7.f)));
+		series = _mm_add_ps(_mm_set1_ps(2.f / 3.f), _mm_mul_ps(t2, series));
+		series = _mm_add_ps(_mm_set1_ps(2.f), _mm_mul_ps(t2, series));
+
+		__m128 ln = _mm_add_ps(_mm_mul_ps(exponent, _mm_set1_ps(ln2)), _mm_mul_ps(t, series));
+		__m128 result = _mm_add_ps(_mm_mul_ps(ln, _mm_set1_ps(decibelsPerNeper)), _mm_set1_ps(offset));
+
+		result = _mm_max_ps(result, _mm_set1_ps(MeterFloorDecibels));
+		result = _mm_min_ps(result, _mm_set1_ps(MeterCeilingDecibels));
+		_mm_storeu_ps(decibels + i, result);
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		float level = std::max(levels[i], MeterFloor);
+		std::uint32_t bits;
+		std::memcpy(&bits, &level, sizeof(bits));
+
+		float exponent = static_cast<float>(static_cast<int>(bits >> 23) - 127);
+		std::uint32_t mantissaBits = (bits & 0x007FFFFFu) | 0x3F800000u;
+		float mantissa;
+		std::memcpy(&mantissa, &mantissaBits, sizeof(mantissa));
+
+		float t = (mantissa - 1.f) / (mantissa + 1.f);
+		float t2 = t * t;
+		float series = 2.f + t2 * (2.f / 3.f + t2 * (2.f / 5.f + t2 * (2.f / 7.f)));
+
+		float ln = exponent * ln2 + t * series;
+		float result = ln * decibelsPerNeper + offset;
+
+		decibels[i] = std::min(std::max(result, MeterFloorDecibels), MeterCeilingDecibels);
+	}
+}
+
+// Writes the RMS and peak dB of each meter as pairs into levels, which must
+// hold 2 * count floats. Unknown meters read as silence. Returns the number of
+// valid meters.
+int GetMeterLevels(const unsigned int* meterIndices, float* levels, int count)
+{
+	if (!meterIndices || !levels)
+	{
+		return 0;
+	}
+
+	int found = 0;
+
+	for (int i = 0; i < count; i++)
+	{
+		auto meter = meterList.Get(meterIndices[i]);
+
+		if (meter)
+		{
+			levels[i * 2] = meterRmsDecibels[meter->slot];
+			levels[i * 2 + 1] = meterPeakDecibels[meter->slot];
+			found++;
+		}
+		else
+		{
+			levels[i * 2] = MeterFloorDecibels;
+			levels[i * 2 + 1] = MeterFloorDecibels;
+		}
+	}
+
+	return found;
+}
+
+// Spectrum taps. Each tap owns an FFT DSP that is added to the head of the
+// target's channel group as soon as the group exists; Update() folds the FFT
+// bins into log-spaced bands and converts them to dB into the tap's own
+// buffer, which GetSpectrum() copies out.
+HandleTable<SpectrumTap> spectrumList;
+std::vector<SpectrumTap*> spectrums;
+
+// Lowest band edge in Hz.
+const float SpectrumMinFrequency = 20.f;
+
+static int AddSpectrum(MeterTargetType type, void* target, int windowSize, int bandCount)
+{
+	// FMOD accepts power of two windows from 128 to 16384 samples.
+	if (windowSize < 128 || windowSize > 16384 || (windowSize & (windowSize - 1)) != 0)
+	{
+		return -1;
+	}
+
+	int binCount = windowSize / 2;
+
+	if (bandCount < 1 || bandCount > binCount)
+	{
+		return -1;
+	}
+
+	FMOD::DSP* dsp = nullptr;
+
+	if (!ERROR_CHECK(coreSystem->createDSPByType(FMOD_DSP_TYPE_FFT, &dsp)))
+	{
+		return -1;
+	}
+
+	dsp->setParameterInt(FMOD_DSP_FFT_WINDOWSIZE, windowSize);
+	dsp->setParameterInt(FMOD_DSP_FFT_WINDOWTYPE, FMOD_DSP_FFT_WINDOW_HANNING);
+
+	auto tap = new SpectrumTap();
+	int handle = spectrumList.Add(tap);
+
+	if (handle < 0)
+	{
+		dsp->release();
+		delete tap;
+		return -1;
+	}
+
+	int sampleRate = 48000;
+	coreSystem->getSoftwareFormat(&sampleRate, nullptr, nullptr);
+
+	float maxFrequency = sampleRate * 0.5f;
+	float binWidth = static_cast<float>(sampleRate) / windowSize;
+
+	tap->type = type;
+	tap->target = target;
+	tap->group = nullptr;
+	tap->dsp = dsp;
+	tap->windowSize = windowSize;
+	tap->bandEdges.resize(bandCount + 1);
+	tap->bandLevels.assign(bandCount, 0.f);
+	tap->bands.assign(bandCount, MeterFloorDecibels);
+
+	// Band k spans SpectrumMinFrequency * ratio^k to ratio^(k + 1). Bands too
+	// narrow to hold a bin at low frequencies are widened to one bin, pushing
+	// the following edges up, and the last edge always ends at the Nyquist bin.
+	float ratio = std::pow(maxFrequency / SpectrumMinFrequency, 1.f / bandCount);
+	float edge = SpectrumMinFrequency;
+
+	tap->bandEdges[0] = std::min(static_cast<int>(SpectrumMinFrequency / binWidth), binCount - bandCount);
+
+	for (int k = 1; k <= bandCount; k++)
+	{
+		edge *= ratio;
+		int bin = static_cast<int>(edge / binWidth);
+		tap->bandEdges[k] = std::min(std::max(bin, tap->bandEdges[k - 1] + 1), binCount - (bandCount - k));
+	}
+
+	tap->bandEdges[bandCount] = binCount;
+
+	spectrums.push_back(tap);
+
+	return handle;
+}
+
+int AddInstanceSpectrum(FMOD::Studio::EventInstance* instance, int windowSize, int bandCount)
+{
+	if (!instance || !instance->isValid())
+	{
+		return -1;
+	}
+
+	return AddSpectrum(METER_INSTANCE, instance, windowSize, bandCount);
+}
+
+int AddBusSpectrum(const unsigned int& busIndex, int windowSize, int bandCount)
+{
+	auto bus = busList.Get(busIndex);
+
+	if (!bus || !ERROR_CHECK(bus->lockChannelGroup()))
+	{
+		return -1;
+	}
+
+	int handle = AddSpectrum(METER_BUS, bus, windowSize, bandCount);
+
+	if (handle < 0)
+	{
+		bus->unlockChannelGroup();
+	}
+
+	return handle;
+}
+
+// The target's current channel group, or nullptr if it has none or the target
+// is gone. Core objects aren't handle checked, so tap->group may only be
+// used while it is still the group returned here.
+static FMOD::ChannelGroup* SpectrumGroup(SpectrumTap* tap)
+{
+	FMOD::ChannelGroup* group = nullptr;
+	FMOD_RESULT result;
+
+	if (tap->type == METER_INSTANCE)
+	{
+		auto instance = static_cast<FMOD::Studio::EventInstance*>(tap->target);
+		FMOD_STUDIO_PLAYBACK_STATE state = FMOD_STUDIO_PLAYBACK_STOPPED;
+
+		// A stopped instance's group is on its way out.
+		if (instance->getPlaybackState(&state) != FMOD_OK || state == FMOD_STUDIO_PLAYBACK_STOPPED)
+		{
+			return nullptr;
+		}
+
+		result = instance->getChannelGroup(&group);
+	}
+	else
+	{
+		result = static_cast<FMOD::Studio::Bus*>(tap->target)->getChannelGroup(&group);
+	}
+
+	return result == FMOD_OK ? group : nullptr;
+}
+
+bool RemoveSpectrum(const unsigned int& spectrumIndex)
+{
+	auto tap = spectrumList.Get(spectrumIndex);
+
+	if (!tap)
+	{
+		return false;
+	}
+
+	if (tap->group && SpectrumGroup(tap) == tap->group)
+	{
+		tap->group->removeDSP(tap->dsp);
+	}
+	else
+	{
+		tap->dsp->disconnectAll(true, true);
+	}
+
+	tap->dsp->release();
+
+	if (tap->type == METER_BUS)
+	{
+		static_cast<FMOD::Studio::Bus*>(tap->target)->unlockChannelGroup();
+	}
+
+	spectrums.erase(std::find(spectrums.begin(), spectrums.end(), tap));
+	spectrumList.Remove(spectrumIndex);
+	delete tap;
+
+	return true;
+}
+
+static void ReadSpectrum(SpectrumTap* tap)
+{
+	FMOD::ChannelGroup* group = SpectrumGroup(tap);
+
+	if (group != tap->group)
+	{
+		// The old group was destroyed with the instance's playback, so it is
+		// forgotten rather than touched. Only the tap's own DSP is detached.
+		if (tap->group)
+		{
+			tap->dsp->disconnectAll(true, true);
+		}
+
+		tap->group = group && ERROR_CHECK(group->addDSP(FMOD_CHANNELCONTROL_DSP_HEAD, tap->dsp)) ? group : nullptr;
+	}
+
+	FMOD_DSP_PARAMETER_FFT* fft = nullptr;
+
+	if (tap->group)
+	{
+		tap->dsp->getParameterData(FMOD_DSP_FFT_SPECTRUMDATA, reinterpret_cast<void**>(&fft), nullptr, nullptr, 0);
+	}
+
+	int bandCount = static_cast<int>(tap->bandLevels.size());
+
+	if (!fft || fft->numchannels < 1 || fft->length < tap->bandEdges[bandCount])
+	{
+		std::fill(tap->bandLevels.begin(), tap->bandLevels.end(), 0.f);
+		return;
+	}
+
+	// Each band is the peak bin magnitude averaged over the channels.
+	float channelScale = 1.f / fft->numchannels;
+
+	for (int k = 0; k < bandCount; k++)
+	{
+		float level = 0.f;
+
+		for (int bin = tap->bandEdges[k]; bin < tap->bandEdges[k + 1]; bin++)
+		{
+			float sum = 0.f;
+
+			for (int channel = 0; channel < fft->numchannels; channel++)
+			{
+				sum += fft->spectrum[channel][bin];
+			}
+
+			level = std::max(level, sum * channelScale);
+		}
+
+		tap->bandLevels[k] = level;
+	}
+}
+
+void UpdateSpectrums()
+{
+	for (auto tap : spectrums)
+	{
+		ReadSpectrum(tap);
+		LevelsToDecibels(tap->bandLevels.data(), tap->bands.data(), static_cast<int>(tap->bands.size()), 0.f);
+	}
+}
+
+// Copies up to count band levels in dB into bands and returns the number
+// copied, or -1 if the spectrum doesn't exist.
+int GetSpectrum(const unsigned int& spectrumIndex, float* bands, int count)
+{
+	auto tap = spectrumList.Get(spectrumIndex);
+
+	if (!tap || !bands)
+	{
+		return -1;
+	}
+
+	count = std::max(std::min(count, static_cast<int>(tap->bands.size())), 0);
+	std::memcpy(bands, tap->bands.data(), sizeof(float) * count);
+
+	return count;
+}
+
+float GetGlobalParameterByName(const char* parameterName)
+{
+	float value, finalValue;
+	auto result = studioSystem->getParameterByName(parameterName, &value, &finalValue);
+
+	if (result != FMOD_OK) 
+	{
+		return -1.f;
+	}
+
+	return finalValue;
+}
+
+bool SetGlobalParameterByName(const char* parameterName, float value,
+	bool ignoreSeekSpeed)
+{
+	return ApplyParameterByName(nullptr, parameterName, value, ignoreSeekSpeed);
+}
+
+float GetParameterByName(const unsigned int& index, const char* parameterName)
+{
+	auto instance = instanceList.Get(index);
+
+	if (!instance) 
+	{
+		return -1.f;
+	}
+
+	float value, finalValue;
+
+	auto result = instance->getParameterByName(parameterName, &value, &finalValue);
+
+	if (result != FMOD_OK) 
+	{
+		return -1.f;
+	}
+
+	return finalValue;
+}
+
+bool SetParameterByName(const unsigned int& index, const char* parameterName, float value,
+	bool ignoreSeekSpeed)
+{
+	auto instance = instanceList.Get(index);
+
+	if (!instance) 
+	{
+		return false;
+	}
+
+	return ApplyParameterByName(instance, parameterName, value, ignoreSeekSpeed);
+}
+
+static int InternParameterID(const FMOD_STUDIO_PARAMETER_ID& id)
+{
+	std::uint64_t key = PackParameterID(id);
+	auto found = parameterIdLookup.find(key);
+
+	if (found != parameterIdLookup.end())
+	{
+		return found->second;
+	}
+
+	int handle = static_cast<int>(parameterIdList.size());
+	parameterIdList.push_back(id);
+	parameterIdLookup.emplace(key, handle);
+
+	return handle;
+}
+
+static const FMOD_STUDIO_PARAMETER_ID* GetInternedParameterID(const unsigned int& parameterId)
+{
+	if (parameterId >= parameterIdList.size())
+	{
+		return nullptr;
+	}
+
+	return &parameterIdList[parameterId];
+}
+
+static int DescribeParameter(FMOD::Studio::EventDescription* eventDescription, const char* parameterName)
+{
+	if (!parameterName)
+	{
+		return -1;
+	}
+
+	FMOD_STUDIO_PARAMETER_DESCRIPTION parameterDescription;
+	auto result = eventDescription->getParameterDescriptionByName(parameterName, &parameterDescription);
+
+	if (result != FMOD_OK)
+	{
+		return -1;
+	}
+
+	return InternParameterID(parameterDescription.id);
+}
+
+int GetParameterID(const char* eventPath, const char* parameterName)
+{
+	const EventInfo* eventInfo = GetEventInfo(eventPath);
+
+	if (!eventInfo)
+	{
+		return -1;
+	}
+
+	return DescribeParameter(eventInfo->description, parameterName);
+}
+
+int GetInstanceParameterID(const unsigned int& index, const char* parameterName)
+{
+	auto instance = instanceList.Get(index);
+
+	if (!instance)
+	{
+		return -1;
+	}
+
+	FMOD::Studio::EventDescription* eventDescription = nullptr;
+	auto result = instance->getDescription(&eventDescription);
+
+	if (result != FMOD_OK)
+	{
+		return -1;
+	}
+
+	return DescribeParameter(eventDescription, parameterName);
+}
+
+int GetGlobalParameterID(const char* parameterName)
+{
+	if (!parameterName)
+	{
+		return -1;
+	}
+
+	FMOD_STUDIO_PARAMETER_DESCRIPTION parameterDescription;
+	auto result = studioSystem->getParameterDescriptionByName(parameterName, &parameterDescription);
+
+	if (result != FMOD_OK)
+	{
+		return -1;
+	}
+
+	return InternParameterID(parameterDescription.id);
+}
+
+float GetParameterByID(const unsigned int& index, const unsigned int& parameterId)
+{
+	auto instance = instanceList.Get(index);
+	auto id = GetInternedParameterID(parameterId);
+
+	if (!instance || !id)
+	{
+		return -1.f;
+	}
+
+	float value, finalValue;
+
+	auto result = instance->getParameterByID(*id, &value, &finalValue);
+
+	if (result != FMOD_OK)
+	{
+		return -1.f;
+	}
+
+	return finalValue;
+}
+
+bool SetParameterByID(const unsigned int& index, const unsigned int& parameterId, float value,
+	bool ignoreSeekSpeed)
+{
+	auto instance = instanceList.Get(index);
+	auto id = GetInternedParameterID(parameterId);
+
+	if (!instance || !id)
+	{
+		return false;
+	}
+
+	return ApplyParameters(instance, id, &value, 1, ignoreSeekSpeed);
+}
+
+// Resolves interned handles into the FMOD ID array for one chunk of a
+// setParametersByIDs call. Returns false if any handle is unknown.
+static bool ResolveParameterIDs(const unsigned int* parameterIds, int count, FMOD_STUDIO_PARAMETER_ID* outIds)
+{
+	for (int i = 0; i < count; i++)
+	{
+		auto id = GetInternedParameterID(parameterIds[i]);
+
+		if (!id)
+		{
+			return false;
+		}
+
+		outIds[i] = *id;
+	}
+
+	return true;
+}
+
+// Applies any number of interned parameters to an instance, or global
+// parameters when instance is null, MaxParametersPerCall at a time. Every
+// handle is checked before the first chunk is applied, so an unknown one
+// leaves all values untouched.
+static bool ApplyParametersByIDs(FMOD::Studio::EventInstance* instance, const unsigned int* parameterIds,
+	const float* values, int count, bool ignoreSeekSpeed)
+{
+	for (int i = 0; i < count; i++)
+	{
+		if (!GetInternedParameterID(parameterIds[i]))
+		{
+			return false;
+		}
+	}
+
+	FMOD_STUDIO_PARAMETER_ID ids[MaxParametersPerCall];
+
+	for (int offset = 0; offset < count; offset += MaxParametersPerCall)
+	{
+		int chunk = std::min(count - offset, MaxParametersPerCall);
+
+		if (!ResolveParameterIDs(parameterIds + offset, chunk, ids) ||
+			!ApplyParameters(instance, ids, values + offset, chunk, ignoreSeekSpeed))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool SetParametersByIDs(const unsigned int& index, const unsigned int* parameterIds, float* values, int count,
+	bool ignoreSeekSpeed)
+{
+	auto instance = instanceList.Get(index);
+
+	if (!instance || count <= 0)
+	{
+		return false;
+	}
+
+	return ApplyParametersByIDs(instance, parameterIds, values, count, ignoreSeekSpeed);
+}
+
+float GetGlobalParameterByID(const unsigned int& parameterId)
+{
+	auto id = GetInternedParameterID(parameterId);
+
+	if (!id)
+	{
+		return -1.f;
+	}
+
+	float value, finalValue;
+	auto result = studioSystem->getParameterByID(*id, &value, &finalValue);
+
+	if (result != FMOD_OK)
+	{
+		return -1.f;
+	}
+
+	return finalValue;
+}
+
+bool SetGlobalParameterByID(const unsigned int& parameterId, float value, bool ignoreSeekSpeed)
+{
+	auto id = GetInternedParameterID(parameterId);
+
+	if (!id)
+	{
+		return false;
+	}
+
+	return ApplyParameters(nullptr, id, &value, 1, ignoreSeekSpeed);
+}
+
+bool SetGlobalParametersByIDs(const unsigned int* parameterIds, float* values, int count, bool ignoreSeekSpeed)
+{
+	if (count <= 0)
+	{
+		return false;
+	}
+
+	return ApplyParametersByIDs(nullptr, parameterIds, values, count, ignoreSeekSpeed);
+}
+
+static FMOD_RESULT ResolveMixerObject(const char* path, FMOD::Studio::Bus** bus)
+{
+	return studioSystem->getBus(path, bus);
+}
+
+static FMOD_RESULT ResolveMixerObject(const char* path, FMOD::Studio::VCA** vca)
+{
+	return studioSystem->getVCA(path, vca);
+}
+
+// Returns the handle of the bus or VCA at path, which may also be a GUID
+// string. A cached path is only trusted while its object is still valid, so
+// that a bank unloaded and loaded again resolves to the new object.
+template<typename T>
+static int InternMixerObject(HandleTable<T>& list, MixerLookup& lookup, const char* path)
+{
+	if (!path)
+	{
+		return -1;
+	}
+
+	std::string key(path);
+	auto byPath = lookup.paths.find(key);
+
+	if (byPath != lookup.paths.end())
+	{
+		T* object = list.Get(byPath->second);
+
+		if (object && object->isValid())
+		{
+			return byPath->second;
+		}
+	}
+
+	T* object = nullptr;
+	FMOD_GUID id;
+
+	if (ResolveMixerObject(path, &object) != FMOD_OK || object->getID(&id) != FMOD_OK)
+	{
+		return -1;
+	}
+
+	std::string idKey(reinterpret_cast<const char*>(&id), sizeof(id));
+	auto byID = lookup.ids.find(idKey);
+	int handle;
+
+	if (byID != lookup.ids.end() && list.Get(byID->second) == object)
+	{
+		handle = byID->second;
+	}
+	else
+	{
+		if (byID != lookup.ids.end())
+		{
+			list.Remove(byID->second);
+		}
+
+		handle = list.Add(object);
+
+		if (handle < 0)
+		{
+			return -1;
+		}
+
+		lookup.ids[idKey] = handle;
+	}
+
+	lookup.paths[key] = handle;
+	return handle;
+}
+
+int GetBus(const char* busPath)
+{
+	return InternMixerObject(busList, busLookup, busPath);
+}
+
+float GetBusVolume(const unsigned int& index)
+{
+	auto bus = busList.Get(index);
+
+	if (!bus) 
+	{
+		return -1.f;
+	}
+
+	float volume, finalVolume;
+
+	auto result = bus->getVolume(&volume, &finalVolume);
+
+	if (result != FMOD_OK) 
+	{
+		return -1.f;
+	}
+	else 
+	{
+		return finalVolume;
+	}
+}
+
+bool SetBusVolume(const unsigned int& index, float volume)
+{
+	auto bus = busList.Get(index);
+
+	if (!bus) {
+		return false;
+	}
+
+	return ApplyBusVolume(bus, volume);
+}
+
+// Writes the final volume of each bus into volumes, -1 for busses that fail,
+// and returns the number read.
+int GetBusVolumes(const unsigned int* indices, float* volumes, int count)
+{
+	if (!indices || !volumes)
+	{
+		return 0;
+	}
+
+	int read = 0;
+
+	for (int i = 0; i < count; i++)
+	{
+		volumes[i] = GetBusVolume(indices[i]);
+
+		if (volumes[i] >= 0.f)
+		{
+			read++;
+		}
+	}
+
+	return read;
+}
+
+int SetBusVolumes(const unsigned int* indices, const float* volumes, int count)
+{
+	if (!indices || !volumes)
+	{
+		return 0;
+	}
+
+	int updated = 0;
+
+	for (int i = 0; i < count; i++)
+	{
+		if (SetBusVolume(indices[i], volumes[i]))
+		{
+			updated++;
+		}
+	}
+
+	return updated;
+}
+
+int GetVCA(const char* vcaPath)
+{
+	return InternMixerObject(vcaList, vcaLookup, vcaPath);
+}
+
+float GetVCAVolume(const unsigned int& index)
+{
+	auto vca = vcaList.Get(index);
+
+	if (!vca) {
+		return -1;
+	}
+
+	float volume, finalVolume;
+
+	auto result = vca->getVolume(&volume, &finalVolume);
+
+	if (result != FMOD_OK) {
+		return -1;
+	}
+	else
+		return finalVolume;
+}
+
+bool SetVCAVolume(const unsigned int& index, float volume)
+{
+	auto vca = vcaList.Get(index);
+
+	if (!vca) {
+		return false;
+	}
+
+	return ApplyVCAVolume(vca, volume);
+}
+
+// Reads the optional options table passed as the last argument of fmod.init.
+// Indexed by FMOD_SPEAKERMODE.
+const int SpeakerModeCount = 9;
+static const char* speakerModeNames[SpeakerModeCount] = {
+	"default", "raw", "mono", "stereo", "quad", "surround", "5.1", "7.1", "7.1.4"
+};
+
+static void LuaReadInitOptions(lua_State* L, int index, InitOptions& options)
+{
+	if (!lua_istable(L, index))
+	{
+		return;
+	}
+
+	lua_getfield(L, index, "memory");
+	const char* memory = lua_tostring(L, -1);
+	if (memory && std::strcmp(memory, "pool") == 0)
+	{
+		options.memoryMode = MEMORY_POOL;
+	}
+	else if (memory && std::strcmp(memory, "arena") == 0)
+	{
+		options.memoryMode = MEMORY_ARENA;
+	}
+	lua_pop(L, 1);
+
+	lua_getfield(L, index, "arenaSize");
+	if (lua_isnumber(L, -1))
+	{
+		options.arenaSize = static_cast<unsigned int>(lua_tonumber(L, -1));
+	}
+	lua_pop(L, 1);
+
+	lua_getfield(L, index, "offline");
+	const char* offline = lua_tostring(L, -1);
+	if (offline && std::strcmp(offline, "wav") == 0)
+	{
+		options.offlineMode = OFFLINE_WAV;
+	}
+	else if (offline && std::strcmp(offline, "nosound") == 0)
+	{
+		options.offlineMode = OFFLINE_NOSOUND;
+	}
+	lua_pop(L, 1);
+
+	lua_getfield(L, index, "outputFile");
+	if (lua_isstring(L, -1))
+	{
+		options.outputFile = lua_tostring(L, -1);
+	}
+	lua_pop(L, 1);
+
+	// A profile only picks the buffer size; explicit fields below win.
+	lua_getfield(L, index, "profile");
+	const char* profile = lua_tostring(L, -1);
+	if (profile && std::strcmp(profile, "lowLatency") == 0)
+	{
+		options.dspBufferLength = 256;
+		options.dspBufferCount = 4;
+	}
+	else if (profile && std::strcmp(profile, "lowPower") == 0)
+	{
+		options.dspBufferLength = 2048;
+		options.dspBufferCount = 4;
+	}
+	lua_pop(L, 1);
+
+	lua_getfield(L, index, "dspBufferLength");
+	if (lua_isnumber(L, -1))
+	{
+		options.dspBufferLength = static_cast<unsigned int>(lua_tonumber(L, -1));
+	}
+	lua_pop(L, 1);
+
+	lua_getfield(L, index, "dspBufferCount");
+	if (lua_isnumber(L, -1))
+	{
+		options.dspBufferCount = static_cast<int>(lua_tonumber(L, -1));
+	}
+	lua_pop(L, 1);
+
+	lua_getfield(L, index, "sampleRate");
+	if (lua_isnumber(L, -1))
+	{
+		options.sampleRate = static_cast<int>(lua_tonumber(L, -1));
+	}
+	lua_pop(L, 1);
+
+	lua_getfield(L, index, "speakerMode");
+	const char* speakerMode = lua_tostring(L, -1);
+	for (int mode = 0; speakerMode && mode < SpeakerModeCount; mode++)
+	{
+		if (std::strcmp(speakerMode, speakerModeNames[mode]) == 0)
+		{
+			options.speakerMode = static_cast<FMOD_SPEAKERMODE>(mode);
+		}
+	}
+	lua_pop(L, 1);
+
+	lua_getfield(L, index, "streamBufferMs");
+	if (lua_isnumber(L, -1))
+	{
+		options.streamBufferMs = static_cast<unsigned int>(lua_tonumber(L, -1));
+	}
+	lua_pop(L, 1);
+
+	lua_getfield(L, index, "decodeBufferMs");
+	if (lua_isnumber(L, -1))
+	{
+		options.decodeBufferMs = static_cast<unsigned int>(lua_tonumber(L, -1));
+	}
+	lua_pop(L, 1);
+
+	lua_getfield(L, index, "vol0VirtualVol");
+	if (lua_isnumber(L, -1))
+	{
+		options.vol0VirtualVol = static_cast<float>(lua_tonumber(L, -1));
+	}
+	lua_pop(L, 1);
+
+	lua_getfield(L, index, "maxVorbisCodecs");
+	if (lua_isnumber(L, -1))
+	{
+		options.maxVorbisCodecs = static_cast<int>(lua_tonumber(L, -1));
+	}
+	lua_pop(L, 1);
+
+	lua_getfield(L, index, "maxFADPCMCodecs");
+	if (lua_isnumber(L, -1))
+	{
+		options.maxFADPCMCodecs = static_cast<int>(lua_tonumber(L, -1));
+	}
+	lua_pop(L, 1);
+}
+
+static int love_fmod_init(lua_State* L)
+{
+	InitOptions options;
+	LuaReadInitOptions(L, 5, options);
+
+	lua_pushboolean(L,
+		Init(LuaIntDefault(L, 1, 0), LuaIntDefault(L, 2, 32),
+			LuaIntDefault(L, 3, 128), LuaIntDefault(L, 4, 1), options));
+	return 1;
+}
+
+static int love_fmod_get_latency_info(lua_State* L)
+{
+	LatencyInfo info;
+
+	if (!GetLatencyInfo(info))
+	{
+		lua_pushnil(L);
+		return 1;
+	}
+
+	const char* streamUnit = info.streamBufferUnit == FMOD_TIMEUNIT_MS ? "ms" :
+		info.streamBufferUnit == FMOD_TIMEUNIT_PCM ? "pcm" :
+		info.streamBufferUnit == FMOD_TIMEUNIT_PCMBYTES ? "pcmbytes" : "rawbytes";
+
+	lua_createtable(L, 0, 8);
+	lua_pushnumber(L, static_cast<lua_Number>(info.dspBufferLength));
+	lua_setfield(L, -2, "dspBufferLength");
+	lua_pushnumber(L, static_cast<lua_Number>(info.dspBufferCount));
+	lua_setfield(L, -2, "dspBufferCount");
+	lua_pushnumber(L, static_cast<lua_Number>(info.sampleRate));
+	lua_setfield(L, -2, "sampleRate");
+	lua_pushstring(L, info.speakerMode >= 0 && info.speakerMode < SpeakerModeCount ?
+		speakerModeNames[info.speakerMode] : "unknown");
+	lua_setfield(L, -2, "speakerMode");
+	lua_pushnumber(L, static_cast<lua_Number>(info.streamBufferSize));
+	lua_setfield(L, -2, "streamBufferSize");
+	lua_pushstring(L, streamUnit);
+	lua_setfield(L, -2, "streamBufferUnit");
+	lua_pushnumber(L, static_cast<lua_Number>(info.blockMs));
+	lua_setfield(L, -2, "blockMs");
+	lua_pushnumber(L, static_cast<lua_Number>(info.latencyMs));
+	lua_setfield(L, -2, "latencyMs");
+	return 1;
+}
+
+// Returns the hash as 16 hex digits, so it survives Lua numbers and can be
+// compared with a golden file as a string.
+static int love_fmod_get_offline_capture(lua_State* L)
+{
+	if (!IsOffline())
+	{
+		lua_pushnil(L);
+		return 1;
+	}
+
+	const OfflineCapture& capture = GetOfflineCapture();
+
+	char hash[17];
+	std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(capture.hash));
+
+	lua_createtable(L, 0, 4);
+	lua_pushstring(L, hash);
+	lua_setfield(L, -2, "hash");
+	lua_pushnumber(L, static_cast<lua_Number>(capture.frames));
+	lua_setfield(L, -2, "frames");
+	lua_pushnumber(L, static_cast<lua_Number>(capture.channels));
+	lua_setfield(L, -2, "channels");
+	lua_pushnumber(L, static_cast<lua_Number>(capture.clock));
+	lua_setfield(L, -2, "seconds");
+	return 1;
+}
+
+static int love_fmod_reset_offline_capture(lua_State* L)
+{
+	ResetOfflineCapture();
+	return 0;
+}
+
+static int love_fmod_get_memory_stats(lua_State* L)
+{
+	static const char* modeNames[] = { "system", "pool", "arena" };
+
+	MemoryStats stats;
+	GetMemoryStats(stats);
+
+	lua_createtable(L, 0, 7);
+	lua_pushstring(L, modeNames[stats.mode]);
+	lua_setfield(L, -2, "mode");
+	lua_pushnumber(L, static_cast<lua_Number>(stats.currentBytes));
+	lua_setfield(L, -2, "currentBytes");
+	lua_pushnumber(L, static_cast<lua_Number>(stats.peakBytes));
+	lua_setfield(L, -2, "peakBytes");
+	lua_pushnumber(L, static_cast<lua_Number>(stats.reservedBytes));
+	lua_setfield(L, -2, "reservedBytes");
+	lua_pushnumber(L, static_cast<lua_Number>(stats.failedAllocations));
+	lua_setfield(L, -2, "failedAllocations");
+	lua_pushnumber(L, static_cast<lua_Number>(stats.largeAllocations));
+	lua_setfield(L, -2, "largeAllocations");
+
+	lua_createtable(L, static_cast<int>(stats.sizeClasses.size()), 0);
+	for (std::size_t i = 0; i < stats.sizeClasses.size(); i++)
+	{
+		const PoolSizeClassStats& sizeClass = stats.sizeClasses[i];
+
+		lua_createtable(L, 0, 5);
+		lua_pushnumber(L, static_cast<lua_Number>(sizeClass.blockSize));
+		lua_setfield(L, -2, "blockSize");
+		lua_pushnumber(L, static_cast<lua_Number>(sizeClass.inUse));
+		lua_setfield(L, -2, "inUse");
+		lua_pushnumber(L, static_cast<lua_Number>(sizeClass.peakInUse));
+		lua_setfield(L, -2, "peakInUse");
+		lua_pushnumber(L, static_cast<lua_Number>(sizeClass.allocations));
+		lua_setfield(L, -2, "allocations");
+		lua_pushnumber(L, static_cast<lua_Number>(sizeClass.chunks));
+		lua_setfield(L, -2, "chunks");
+		lua_rawseti(L, -2, static_cast<int>(i + 1));
+	}
+	lua_setfield(L, -2, "sizeClasses");
+
+	return 1;
+}
+
+static int love_fmod_update(lua_State* L)
+{
+	bool result = Update();
+	lua_pushboolean(L, result);
+	return 1;
+}
+
+static int love_fmod_load_bank(lua_State* L)
+{
+	const char* input = lua_tostring(L, 1);
+	int flags = static_cast<int>(lua_tointeger(L, 2));
+	bool memoryMapped = lua_toboolean(L, 3);
+	int index = LoadBank(input, flags, memoryMapped);
+	lua_Integer i = static_cast<lua_Integer>(index);
+	lua_pushinteger(L, i);
+	return 1;
+}
+
+static int love_fmod_unload_bank(lua_State* L)
+{
+	int index = static_cast<int>(lua_tointeger(L, 1));
+	bool result = UnloadBank(index);
+	lua_pushboolean(L, result);
+	return 1;
+}
+
+static int love_fmod_load_bank_async(lua_State* L)
+{
+	const char* input = lua_tostring(L, 1);
+	int flags = static_cast<int>(lua_tointeger(L, 2));
+	bool loadSampleData = lua_toboolean(L, 3);
+	bool memoryMapped = lua_toboolean(L, 4);
+	int index = LoadBankAsync(input, flags, loadSampleData, memoryMapped);
+	lua_pushinteger(L, index);
+	return 1;
+}
+
+static int love_fmod_get_bank_loading_state(lua_State* L)
+{
+	int index = static_cast<int>(lua_tointeger(L, 1));
+	int loadingState = -1, sampleLoadingState = -1;
+	GetBankLoadingState(index, loadingState, sampleLoadingState);
+	lua_pushinteger(L, loadingState);
+	lua_pushinteger(L, sampleLoadingState);
+	return 2;
+}
+
+static int love_fmod_load_bank_sample_data(lua_State* L)
+{
+	int index = static_cast<int>(lua_tointeger(L, 1));
+	bool result = LoadBankSampleData(index);
+	lua_pushboolean(L, result);
+	return 1;
+}
+
+static int love_fmod_unload_bank_sample_data(lua_State* L)
+{
+	int index = static_cast<int>(lua_tointeger(L, 1));
+	bool result = UnloadBankSampleData(index);
+	lua_pushboolean(L, result);
+	return 1;
+}
+
+static int love_fmod_get_bank_load_progress(lua_State* L)
+{
+	int index = static_cast<int>(lua_tointeger(L, 1));
+	float progress = GetBankLoadProgress(index);
+	lua_pushnumber(L, static_cast<lua_Number>(progress));
+	return 1;
+}
+
+static int love_fmod_get_loading_progress(lua_State* L)
+{
+	int pending = 0;
+	float progress = GetLoadingProgress(pending);
+	lua_pushnumber(L, static_cast<lua_Number>(progress));
+	lua_pushinteger(L, pending);
+	return 2;
+}
+
+static int love_fmod_set_sample_budget(lua_State* L)
+{
+	SetSampleBudget(static_cast<long long>(lua_tonumber(L, 1)));
+	return 0;
+}
+
+static int love_fmod_prefetch_sample_data(lua_State* L)
+{
+	bool result = PrefetchSampleData(lua_tostring(L, 1), static_cast<long long>(lua_tonumber(L, 2)));
+	lua_pushboolean(L, result);
+	return 1;
+}
+
+static int love_fmod_retain_sample_data(lua_State* L)
+{
+	bool result = RetainSampleData(lua_tostring(L, 1));
+	lua_pushboolean(L, result);
+	return 1;
+}
+
+static int love_fmod_release_sample_data(lua_State* L)
+{
+	bool result = ReleaseSampleData(lua_tostring(L, 1));
+	lua_pushboolean(L, result);
+	return 1;
+}
+
+// Returns the state name, the size charged against the budget and the retain
+// count, or nil for events the residency manager hasn't loaded.
+static int love_fmod_get_sample_data_state(lua_State* L)
+{
+	static const char* stateNames[] = { "unloaded", "loading", "loaded", "error" };
+
+	const SampleResidency* residency = GetSampleResidency(lua_tostring(L, 1));
+
+	if (!residency)
+	{
+		lua_pushnil(L);
+		return 1;
+	}
+
+	lua_pushstring(L, stateNames[residency->state]);
+	lua_pushnumber(L, static_cast<lua_Number>(residency->bytes));
+	lua_pushinteger(L, residency->pins);
+	return 3;
+}
+
+// Returns the async bank loads that finished since the last call as an array
+// of { bank, path, loaded, result } tables, and clears the queue.
+static int love_fmod_get_bank_events(lua_State* L)
+{
+	lua_createtable(L, static_cast<int>(bankLoadEvents.size()), 0);
+
+	for (std::size_t i = 0; i < bankLoadEvents.size(); i++)
+	{
+		const BankLoadEvent& event = bankLoadEvents[i];
+
+		lua_createtable(L, 0, 4);
+		lua_pushinteger(L, event.bank);
+		lua_setfield(L, -2, "bank");
+		lua_pushstring(L, event.path.c_str());
+		lua_setfield(L, -2, "path");
+		lua_pushboolean(L, event.loaded);
+		lua_setfield(L, -2, "loaded");
+		lua_pushinteger(L, event.result);
+		lua_setfield(L, -2, "result");
+		lua_rawseti(L, -2, static_cast<int>(i + 1));
+	}
+
+	bankLoadEvents.clear();
+	return 1;
+}
+
+static const char* EventCallbackTypeName(FMOD_STUDIO_EVENT_CALLBACK_TYPE type)
+{
+	switch (type)
+	{
+	case FMOD_STUDIO_EVENT_CALLBACK_STARTED:
+		return "started";
+	case FMOD_STUDIO_EVENT_CALLBACK_STOPPED:
+		return "stopped";
+	case FMOD_STUDIO_EVENT_CALLBACK_TIMELINE_MARKER:
+		return "marker";
+	case FMOD_STUDIO_EVENT_CALLBACK_TIMELINE_BEAT:
+		return "beat";
+	case FMOD_STUDIO_EVENT_CALLBACK_VIRTUAL_TO_REAL:
+		return "real";
+	case FMOD_STUDIO_EVENT_CALLBACK_REAL_TO_VIRTUAL:
+		return "virtual";
+	default:
+		return "unknown";
+	}
+}
+
+// Returns the event callbacks received up to the last update as an array of
+// { tag, type, dspClock, ... } tables in the order they happened, and clears
+// the queue.
+static int love_fmod_get_event_callbacks(lua_State* L)
+{
+	lua_createtable(L, static_cast<int>(eventCallbacks.size()), 0);
+
+	for (std::size_t i = 0; i < eventCallbacks.size(); i++)
+	{
+		const EventCallbackRecord& record = eventCallbacks[i];
+
+		lua_createtable(L, 0, 8);
+		lua_pushinteger(L, record.tag);
+		lua_setfield(L, -2, "tag");
+		lua_pushstring(L, EventCallbackTypeName(record.type));
+		lua_setfield(L, -2, "type");
+		lua_pushnumber(L, static_cast<lua_Number>(record.dspClock));
+		lua_setfield(L, -2, "dspClock");
+
+		if (record.type == FMOD_STUDIO_EVENT_CALLBACK_TIMELINE_MARKER)
+		{
+			lua_pushinteger(L, record.position);
+			lua_setfield(L, -2, "position");
+			lua_pushstring(L, record.name);
+			lua_setfield(L, -2, "name");
+		}
+		else if (record.type == FMOD_STUDIO_EVENT_CALLBACK_TIMELINE_BEAT)
+		{
+			lua_pushinteger(L, record.position);
+			lua_setfield(L, -2, "position");
+			lua_pushinteger(L, record.bar);
+			lua_setfield(L, -2, "bar");
+			lua_pushinteger(L, record.beat);
+			lua_setfield(L, -2, "beat");
+			lua_pushnumber(L, static_cast<lua_Number>(record.tempo));
+			lua_setfield(L, -2, "tempo");
+		}
+
+		lua_rawseti(L, -2, static_cast<int>(i + 1));
+	}
+
+	eventCallbacks.clear();
+	return 1;
+}
+
+static int love_fmod_setnumlisteners(lua_State* L)
+{
+	int listeners = static_cast<int>(lua_tointeger(L, 1));
+	bool result = SetNumListeners(listeners);
+	lua_pushboolean(L, result);
+	return 1;
+}
+
+static int love_fmod_set_listener3d_position(lua_State* L)
+{
+	int listener = static_cast<int>(lua_tointeger(L, 1));
+	float posX = static_cast<float>(lua_tonumber(L, 2));
+	float posY = static_cast<float>(lua_tonumber(L, 3));
+	float posZ = static_cast<float>(lua_tonumber(L, 4));
+	float dirX = static_cast<float>(lua_tonumber(L, 5));
+	float dirY = static_cast<float>(lua_tonumber(L, 6));
+	float dirZ = static_cast<float>(lua_tonumber(L, 7));
+	float oX = static_cast<float>(lua_tonumber(L, 8));
+	float oY = static_cast<float>(lua_tonumber(L, 9));
+	float oZ = static_cast<float>(lua_tonumber(L, 10));
+
+	bool result = SetListener3DPosition(listener, posX, posY, posZ, dirX, dirY,
+		dirZ, oX, oY, oZ);
+	lua_pushboolean(L, result);
+	return 1;
+}
+
+static int love_fmod_create_instance(lua_State* L)
+{
+	const char* input = lua_tostring(L, 1);
+	int index = CreateInstance(input);
+
+	if (index >= 0 && lua_toboolean(L, 2))
+	{
+		SetInstanceAutoRelease(index, true);
+	}
+
+	lua_pushinteger(L, index);
+	return 1;
+}
+
+static int love_fmod_set_instance_auto_release(lua_State* L)
+{
+	int index = static_cast<int>(lua_tointeger(L, 1));
+	bool enabled = lua_toboolean(L, 2);
+	lua_pushboolean(L, SetInstanceAutoRelease(index, enabled));
+	return 1;
+}
+
+static int love_fmod_is_instance_valid(lua_State* L)
+{
+	int index = static_cast<int>(lua_tointeger(L, 1));
+	lua_pushboolean(L, instanceList.Get(index) != nullptr);
+	return 1;
+}
+
+static int love_fmod_start_instance(lua_State* L)
+{
+	int index = static_cast<int>(lua_tointeger(L, 1));
+	bool result = StartInstance(index);
+	lua_pushboolean(L, result);
+	return 1;
+}
 
 static int love_fmod_stop_instance(lua_State* L)
 {
 	int index = static_cast<int>(lua_tointeger(L, 1));
-	int stopMode = static_cast<int>(lua_tointeger(L, 2));
-	bool result = StopInstance(index, stopMode);
-	lua_pushboolean(L, result);
+	int stopMode = static_cast<int>(lua_tointeger(L, 2));
+	bool result = StopInstance(index, stopMode);
+	lua_pushboolean(L, result);
+	return 1;
+}
+
+static int love_fmod_release_instance(lua_State* L)
+{
+	int index = static_cast<int>(lua_tointeger(L, 1));
+	bool result = ReleaseInstance(index);
+	lua_pushboolean(L, result);
+	return 1;
+}
+
+static int love_fmod_set3d_attributes(lua_State* L)
+{
+	int index = static_cast<int>(lua_tointeger(L, 1));
+	float posX = static_cast<float>(lua_tonumber(L, 2));
+	float posY = static_cast<float>(lua_tonumber(L, 3));
+	float posZ = static_cast<float>(lua_tonumber(L, 4));
+	float dirX = static_cast<float>(lua_tonumber(L, 5));
+	float dirY = static_cast<float>(lua_tonumber(L, 6));
+	float dirZ = static_cast<float>(lua_tonumber(L, 7));
+	float oX = static_cast<float>(lua_tonumber(L, 8));
+	float oY = static_cast<float>(lua_tonumber(L, 9));
+	float oZ = static_cast<float>(lua_tonumber(L, 10));
+
+	bool result = Set3DAttributes(index, posX, posY, posZ, dirX, dirY, dirZ, oX, oY, oZ);
+	lua_pushboolean(L, result);
+	return 1;
+}
+
+// Scratch arrays for the batch setters, reused across calls.
+std::vector<unsigned int> batchIndexScratch;
+std::vector<float> batchVectorScratch[4];
+
+// Returns the handles at the given stack index: either a table of handles or a
+// light userdata pointing at count 32 bit handles (e.g. ByteData:getPointer()).
+static const unsigned int* LuaHandleArray(lua_State* L, int index, int count)
+{
+	if (lua_islightuserdata(L, index))
+	{
+		return static_cast<const unsigned int*>(lua_touserdata(L, index));
+	}
+
+	if (!lua_istable(L, index))
+	{
+		return nullptr;
+	}
+
+	batchIndexScratch.resize(count);
+
+	for (int i = 0; i < count; i++)
+	{
+		lua_rawgeti(L, index, i + 1);
+		batchIndexScratch[i] = static_cast<unsigned int>(lua_tointeger(L, -1));
+		lua_pop(L, 1);
+	}
+
+	return batchIndexScratch.data();
+}
+
+// Returns count xyz triplets at the given stack index: either a flat table
+// {x1, y1, z1, x2, ...} copied into scratch, or a light userdata pointing at
+// packed floats. Returns null for nil so optional vectors fall back to defaults.
+static const float* LuaVectorArray(lua_State* L, int index, int count, std::vector<float>& scratch)
+{
+	if (lua_islightuserdata(L, index))
+	{
+		return static_cast<const float*>(lua_touserdata(L, index));
+	}
+
+	if (!lua_istable(L, index))
+	{
+		return nullptr;
+	}
+
+	int length = count * 3;
+
+	if (static_cast<int>(lua_objlen(L, index)) < length)
+	{
+		return nullptr;
+	}
+
+	scratch.resize(length);
+
+	for (int i = 0; i < length; i++)
+	{
+		lua_rawgeti(L, index, i + 1);
+		scratch[i] = static_cast<float>(lua_tonumber(L, -1));
+		lua_pop(L, 1);
+	}
+
+	return scratch.data();
+}
+
+static int love_fmod_set3d_attributes_batch(lua_State* L)
+{
+	int count = lua_istable(L, 1) ? static_cast<int>(lua_objlen(L, 1)) : 0;
+	count = LuaIntDefault(L, 6, count);
+
+	const unsigned int* indices = LuaHandleArray(L, 1, count);
+	const float* positions = LuaVectorArray(L, 2, count, batchVectorScratch[0]);
+	const float* forwards = LuaVectorArray(L, 3, count, batchVectorScratch[1]);
+	const float* ups = LuaVectorArray(L, 4, count, batchVectorScratch[2]);
+	const float* velocities = LuaVectorArray(L, 5, count, batchVectorScratch[3]);
+
+	int result = Set3DAttributesBatch(indices, count, positions, forwards, ups, velocities);
+	lua_pushinteger(L, result);
+	return 1;
+}
+
+static int love_fmod_create_emitter(lua_State* L)
+{
+	unsigned int index = static_cast<unsigned int>(lua_tointeger(L, 1));
+
+	FMOD_3D_ATTRIBUTES attributes = {};
+	attributes.position.x = static_cast<float>(lua_tonumber(L, 2));
+	attributes.position.y = static_cast<float>(lua_tonumber(L, 3));
+	attributes.position.z = static_cast<float>(lua_tonumber(L, 4));
+	attributes.forward.z = 1.f;
+	attributes.up.y = 1.f;
+
+	float maxDistance = LuaNumberDefault(L, 5, 0.f);
+	int cullMode = LuaIntDefault(L, 6, EMITTER_CULL_STOP);
+
+	int result = CreateEmitter(index, attributes, maxDistance, static_cast<EmitterCullMode>(cullMode));
+	lua_pushinteger(L, result);
+	return 1;
+}
+
+static int love_fmod_set_emitter_position(lua_State* L)
+{
+	unsigned int index = static_cast<unsigned int>(lua_tointeger(L, 1));
+	float position[3] = { static_cast<float>(lua_tonumber(L, 2)), static_cast<float>(lua_tonumber(L, 3)),
+		static_cast<float>(lua_tonumber(L, 4)) };
+	lua_pushboolean(L, SetEmitterPositions(&index, 1, position) == 1);
+	return 1;
+}
+
+static int love_fmod_set_emitter_positions(lua_State* L)
+{
+	int count = lua_istable(L, 1) ? static_cast<int>(lua_objlen(L, 1)) : 0;
+	count = LuaIntDefault(L, 3, count);
+
+	const unsigned int* indices = LuaHandleArray(L, 1, count);
+	const float* positions = LuaVectorArray(L, 2, count, batchVectorScratch[0]);
+
+	lua_pushinteger(L, SetEmitterPositions(indices, count, positions));
+	return 1;
+}
+
+static int love_fmod_release_emitter(lua_State* L)
+{
+	unsigned int index = static_cast<unsigned int>(lua_tointeger(L, 1));
+	lua_pushboolean(L, ReleaseEmitter(index));
+	return 1;
+}
+
+static int love_fmod_is_emitter_audible(lua_State* L)
+{
+	unsigned int index = static_cast<unsigned int>(lua_tointeger(L, 1));
+	lua_pushboolean(L, IsEmitterAudible(index));
+	return 1;
+}
+
+static int love_fmod_set_motion_smoothing(lua_State* L)
+{
+	SetMotionSmoothing(static_cast<float>(lua_tonumber(L, 1)));
+	return 0;
+}
+
+static int love_fmod_set_motion_interpolation(lua_State* L)
+{
+	SetMotionInterpolation(lua_toboolean(L, 1));
+	return 0;
+}
+
+static int love_fmod_set_emitter_cell_size(lua_State* L)
+{
+	SetEmitterCellSize(static_cast<float>(lua_tonumber(L, 1)));
+	return 0;
+}
+
+static int love_fmod_set_one_shot_coalescing(lua_State* L)
+{
+	const char* input = lua_tostring(L, 1);
+	float radius = lua_isnoneornil(L, 2) ? -1.f : static_cast<float>(lua_tonumber(L, 2));
+	float windowMs = static_cast<float>(lua_tonumber(L, 3));
+	const char* countParameterName = lua_tostring(L, 4);
+	bool result = SetOneShotCoalescing(input, radius, windowMs, countParameterName);
+	lua_pushboolean(L, result);
+	return 1;
+}
+
+static int love_fmod_set_one_shot_rate_limit(lua_State* L)
+{
+	const char* input = lua_tostring(L, 1);
+	int maxStarts = static_cast<int>(lua_tointeger(L, 2));
+	float periodMs = static_cast<float>(lua_tonumber(L, 3));
+	bool result = SetOneShotRateLimit(input, maxStarts, periodMs);
+	lua_pushboolean(L, result);
+	return 1;
+}
+
+static int love_fmod_playoneshot2d(lua_State* L)
+{
+	const char* input = lua_tostring(L, 1);
+	bool result = PlayOneShot2D(input);
+	lua_pushboolean(L, result);
+	return 1;
+}
+
+static int love_fmod_playoneshot3d(lua_State* L)
+{
+	const char* input = lua_tostring(L, 1);
+	float posX = static_cast<float>(lua_tonumber(L, 2));
+	float posY = static_cast<float>(lua_tonumber(L, 3));
+	float posZ = static_cast<float>(lua_tonumber(L, 4));
+	float dirX = static_cast<float>(lua_tonumber(L, 5));
+	float dirY = static_cast<float>(lua_tonumber(L, 6));
+	float dirZ = static_cast<float>(lua_tonumber(L, 7));
+	float oX = static_cast<float>(lua_tonumber(L, 8));
+	float oY = static_cast<float>(lua_tonumber(L, 9));
+	float oZ = static_cast<float>(lua_tonumber(L, 10));
+
+	bool result = PlayOneShot3D(input, posX, posY, posZ, dirX, dirY, dirZ, oX, oY, oZ);
+	lua_pushboolean(L, result);
+	return 1;
+}
+
+static int love_fmod_set_instance_volume(lua_State* L)
+{
+	int index = static_cast<int>(lua_tointeger(L, 1));
+	float volume = static_cast<float>(lua_tonumber(L, 2));
+	bool result = SetInstanceVolume(index, volume);
+	lua_pushboolean(L, result);
+	return 1;
+}
+
+static int love_fmod_is_playing(lua_State* L)
+{
+	int index = static_cast<int>(lua_tointeger(L, 1));
+	bool result = IsPlaying(index);
+	lua_pushboolean(L, result);
+	return 1;
+}
+
+static int love_fmod_set_instance_paused(lua_State* L)
+{
+	int index = static_cast<int>(lua_tointeger(L, 1));
+	bool paused = lua_toboolean(L, 2);
+	bool result = SetInstancePaused(index, paused);
+	lua_pushboolean(L, result);
+	return 1;
+}
+
+static int love_fmod_get_instance_pitch(lua_State* L)
+{
+	int index = static_cast<int>(lua_tointeger(L, 1));
+	float pitch = GetInstancePitch(index);
+	lua_Number result = static_cast<lua_Number>(pitch);
+	lua_pushnumber(L, result);
+	return 1;
+}
+
+static int love_fmod_set_instance_pitch(lua_State* L)
+{
+	int index = static_cast<int>(lua_tointeger(L, 1));
+	float pitch = static_cast<float>(lua_tonumber(L, 2));
+	bool result = SetInstancePitch(index, pitch);
+	lua_pushboolean(L, result);
+	return 1;
+}
+
+static int love_fmod_get_timeline_position(lua_State* L)
+{
+	int index = static_cast<int>(lua_tointeger(L, 1));
+	int position = GetTimelinePosition(index);
+	lua_pushinteger(L, position);
+	return 1;
+}
+
+static int love_fmod_set_timeline_position(lua_State* L)
+{
+	int index = static_cast<int>(lua_tointeger(L, 1));
+	int position = static_cast<int>(lua_tointeger(L, 2));
+	bool result = SetTimelinePosition(index, position);
+	lua_pushboolean(L, result);
+	return 1;
+}
+
+static int love_fmod_get_instance_rms(lua_State* L)
+{
+	int index = static_cast<int>(lua_tointeger(L, 1));
+	float rms = GetInstanceRMS(index);
+	lua_Number result = static_cast<lua_Number>(rms);
+	lua_pushnumber(L, result);
+	return 1;
+}
+
+static int love_fmod_add_bus_spectrum(lua_State* L)
+{
+	unsigned int index = static_cast<unsigned int>(lua_tointeger(L, 1));
+	int windowSize = LuaIntDefault(L, 2, 2048);
+	int bandCount = LuaIntDefault(L, 3, 64);
+	lua_pushinteger(L, AddBusSpectrum(index, windowSize, bandCount));
+	return 1;
+}
+
+static int love_fmod_remove_spectrum(lua_State* L)
+{
+	unsigned int index = static_cast<unsigned int>(lua_tointeger(L, 1));
+	lua_pushboolean(L, RemoveSpectrum(index));
+	return 1;
+}
+
+std::vector<float> spectrumScratch;
+
+// Writes the bands into the light userdata at index 2, or fills the table at
+// index 2 (created if nil) so the same table can be reused every frame.
+static int love_fmod_get_spectrum(lua_State* L)
+{
+	unsigned int index = static_cast<unsigned int>(lua_tointeger(L, 1));
+
+	if (lua_islightuserdata(L, 2))
+	{
+		int count = static_cast<int>(lua_tointeger(L, 3));
+		lua_pushinteger(L, GetSpectrum(index, static_cast<float*>(lua_touserdata(L, 2)), count));
+		return 1;
+	}
+
+	spectrumScratch.resize(16384 / 2);
+	int count = GetSpectrum(index, spectrumScratch.data(), static_cast<int>(spectrumScratch.size()));
+
+	if (count < 0)
+	{
+		lua_pushnil(L);
+		return 1;
+	}
+
+	if (!lua_istable(L, 2))
+	{
+		lua_settop(L, 1);
+		lua_createtable(L, count, 0);
+	}
+	else
+	{
+		lua_pushvalue(L, 2);
+	}
+
+	for (int i = 0; i < count; i++)
+	{
+		lua_pushnumber(L, static_cast<lua_Number>(spectrumScratch[i]));
+		lua_rawseti(L, -2, i + 1);
+	}
+
+	return 1;
+}
+
+std::vector<float> meterLevelScratch;
+
+// Fills the table at index 2 (created if nil) with the RMS and peak dB of
+// each meter as flat pairs, or writes them as floats when both arguments are
+// light userdata. Pass the same table every frame to avoid garbage.
+static int love_fmod_get_meter_levels(lua_State* L)
+{
+	int count = lua_istable(L, 1) ? static_cast<int>(lua_objlen(L, 1)) : 0;
+	count = LuaIntDefault(L, 3, count);
+
+	const unsigned int* indices = LuaHandleArray(L, 1, count);
+
+	if (lua_islightuserdata(L, 2))
+	{
+		lua_pushinteger(L, GetMeterLevels(indices, static_cast<float*>(lua_touserdata(L, 2)), count));
+		return 1;
+	}
+
+	meterLevelScratch.resize(count * 2);
+	GetMeterLevels(indices, meterLevelScratch.data(), count);
+
+	if (!lua_istable(L, 2))
+	{
+		lua_settop(L, 1);
+		lua_createtable(L, count * 2, 0);
+	}
+	else
+	{
+		lua_pushvalue(L, 2);
+	}
+
+	for (int i = 0; i < count * 2; i++)
+	{
+		lua_pushnumber(L, static_cast<lua_Number>(meterLevelScratch[i]));
+		lua_rawseti(L, -2, i + 1);
+	}
+
+	return 1;
+}
+
+static int love_fmod_get_global_parameter_by_name(lua_State* L)
+{
+	const char* input = lua_tostring(L, 1);
+	float parameterValue = GetGlobalParameterByName(input);
+	lua_Number result = static_cast<lua_Number>(parameterValue);
+	lua_pushnumber(L, result);
+	return 1;
+}
+
+static int love_fmod_set_global_parameter_by_name(lua_State* L)
+{
+	const char* input = lua_tostring(L, 1);
+	float parameterValue = static_cast<float>(lua_tonumber(L, 2));
+	bool ignoreSeekSpeed = lua_toboolean(L, 3);
+	bool result = SetGlobalParameterByName(input, parameterValue, ignoreSeekSpeed);
+	lua_pushboolean(L, result);
+	return 1;
+}
+
+static int love_fmod_get_parameter_by_name(lua_State* L)
+{
+	int index = static_cast<int>(lua_tointeger(L, 1));
+	const char* input = lua_tostring(L, 2);
+	float parameterValue = GetParameterByName(index, input);
+	lua_Number result = static_cast<lua_Number>(parameterValue);
+	lua_pushnumber(L, result);
+	return 1;
+}
+
+static int love_fmod_set_parameter_by_name(lua_State* L)
+{
+	int index = static_cast<int>(lua_tointeger(L, 1));
+	const char* input = lua_tostring(L, 2);
+	float parameterValue = static_cast<float>(lua_tonumber(L, 3));
+	bool ignoreSeekSpeed = lua_toboolean(L, 4);
+	bool result = SetParameterByName(index, input, parameterValue, ignoreSeekSpeed);
+	lua_pushboolean(L, result);
+	return 1;
+}
+
+static int love_fmod_get_parameter_id(lua_State* L)
+{
+	const char* parameterName = lua_tostring(L, 2);
+	int result;
+
+	if (lua_type(L, 1) == LUA_TSTRING)
+	{
+		result = GetParameterID(lua_tostring(L, 1), parameterName);
+	}
+	else
+	{
+		int index = static_cast<int>(lua_tointeger(L, 1));
+		result = GetInstanceParameterID(index, parameterName);
+	}
+
+	lua_pushinteger(L, result);
+	return 1;
+}
+
+static int love_fmod_get_global_parameter_id(lua_State* L)
+{
+	const char* input = lua_tostring(L, 1);
+	int result = GetGlobalParameterID(input);
+	lua_pushinteger(L, result);
+	return 1;
+}
+
+static int love_fmod_get_parameter_by_id(lua_State* L)
+{
+	int index = static_cast<int>(lua_tointeger(L, 1));
+	int parameterId = static_cast<int>(lua_tointeger(L, 2));
+	float parameterValue = GetParameterByID(index, parameterId);
+	lua_Number result = static_cast<lua_Number>(parameterValue);
+	lua_pushnumber(L, result);
+	return 1;
+}
+
+static int love_fmod_set_parameter_by_id(lua_State* L)
+{
+	int index = static_cast<int>(lua_tointeger(L, 1));
+	int parameterId = static_cast<int>(lua_tointeger(L, 2));
+	float parameterValue = static_cast<float>(lua_tonumber(L, 3));
+	bool ignoreSeekSpeed = lua_toboolean(L, 4);
+	bool result = SetParameterByID(index, parameterId, parameterValue, ignoreSeekSpeed);
+	lua_pushboolean(L, result);
+	return 1;
+}
+
+// Scratch arrays reused by every multi-parameter call, so reading the Lua
+// tables doesn't allocate once they have grown to the largest call seen.
+std::vector<unsigned int> parameterIdScratch;
+std::vector<float> parameterValueScratch;
+
+// Reads a table of parameter ID handles and a matching table of values into
+// the scratch arrays. Returns the number of pairs, or -1 if the tables are
+// missing or their lengths differ.
+static int LuaReadParameterTables(lua_State* L, int idsIndex, int valuesIndex)
+{
+	if (!lua_istable(L, idsIndex) || !lua_istable(L, valuesIndex))
+	{
+		return -1;
+	}
+
+	int count = static_cast<int>(lua_objlen(L, idsIndex));
+
+	if (count != static_cast<int>(lua_objlen(L, valuesIndex)))
+	{
+		return -1;
+	}
+
+	parameterIdScratch.resize(count);
+	parameterValueScratch.resize(count);
+
+	for (int i = 0; i < count; i++)
+	{
+		lua_rawgeti(L, idsIndex, i + 1);
+		lua_rawgeti(L, valuesIndex, i + 1);
+		parameterIdScratch[i] = static_cast<unsigned int>(lua_tointeger(L, -2));
+		parameterValueScratch[i] = static_cast<float>(lua_tonumber(L, -1));
+		lua_pop(L, 2);
+	}
+
+	return count;
+}
+
+static int love_fmod_set_parameters_by_ids(lua_State* L)
+{
+	int index = static_cast<int>(lua_tointeger(L, 1));
+	int count = LuaReadParameterTables(L, 2, 3);
+	bool ignoreSeekSpeed = lua_toboolean(L, 4);
+	bool result = count > 0 && SetParametersByIDs(index, parameterIdScratch.data(), parameterValueScratch.data(),
+		count, ignoreSeekSpeed);
+	lua_pushboolean(L, result);
+	return 1;
+}
+
+static int love_fmod_get_global_parameter_by_id(lua_State* L)
+{
+	int parameterId = static_cast<int>(lua_tointeger(L, 1));
+	float parameterValue = GetGlobalParameterByID(parameterId);
+	lua_Number result = static_cast<lua_Number>(parameterValue);
+	lua_pushnumber(L, result);
+	return 1;
+}
+
+static int love_fmod_set_global_parameter_by_id(lua_State* L)
+{
+	int parameterId = static_cast<int>(lua_tointeger(L, 1));
+	float parameterValue = static_cast<float>(lua_tonumber(L, 2));
+	bool ignoreSeekSpeed = lua_toboolean(L, 3);
+	bool result = SetGlobalParameterByID(parameterId, parameterValue, ignoreSeekSpeed);
+	lua_pushboolean(L, result);
+	return 1;
+}
+
+static int love_fmod_set_global_parameters_by_ids(lua_State* L)
+{
+	int count = LuaReadParameterTables(L, 1, 2);
+	bool ignoreSeekSpeed = lua_toboolean(L, 3);
+	bool result = count > 0 && SetGlobalParametersByIDs(parameterIdScratch.data(), parameterValueScratch.data(),
+		count, ignoreSeekSpeed);
+	lua_pushboolean(L, result);
+	return 1;
+}
+
+static int love_fmod_get_bus(lua_State* L)
+{
+	const char* input = lua_tostring(L, 1);
+	int result = GetBus(input);
+	lua_pushinteger(L, result);
+	return 1;
+}
+
+static int love_fmod_get_bus_volume(lua_State* L)
+{
+	int index = static_cast<int>(lua_tointeger(L, 1));
+	float volume = GetBusVolume(index);
+	lua_Number result = static_cast<lua_Number>(volume);
+	lua_pushnumber(L, result);
+	return 1;
+}
+
+static int love_fmod_set_bus_volume(lua_State* L)
+{
+	int index = static_cast<int>(lua_tointeger(L, 1));
+	float volume = static_cast<float>(lua_tonumber(L, 2));
+	bool result = SetBusVolume(index, volume);
+	lua_pushboolean(L, result);
+	return 1;
+}
+
+std::vector<float> busVolumeScratch;
+
+// Fills the table at index 2 (created if nil) with the volume of each bus in
+// the table at index 1, or writes floats when both are light userdata.
+static int love_fmod_get_bus_volumes(lua_State* L)
+{
+	int count = lua_istable(L, 1) ? static_cast<int>(lua_objlen(L, 1)) : 0;
+	count = LuaIntDefault(L, 3, count);
+
+	const unsigned int* indices = LuaHandleArray(L, 1, count);
+
+	if (lua_islightuserdata(L, 2))
+	{
+		lua_pushinteger(L, GetBusVolumes(indices, static_cast<float*>(lua_touserdata(L, 2)), count));
+		return 1;
+	}
+
+	busVolumeScratch.resize(count);
+	GetBusVolumes(indices, busVolumeScratch.data(), count);
+
+	if (!lua_istable(L, 2))
+	{
+		lua_settop(L, 1);
+		lua_createtable(L, count, 0);
+	}
+	else
+	{
+		lua_pushvalue(L, 2);
+	}
+
+	for (int i = 0; i < count; i++)
+	{
+		lua_pushnumber(L, static_cast<lua_Number>(busVolumeScratch[i]));
+		lua_rawseti(L, -2, i + 1);
+	}
+
+	return 1;
+}
+
+static int love_fmod_set_bus_volumes(lua_State* L)
+{
+	int count = lua_istable(L, 1) ? static_cast<int>(lua_objlen(L, 1)) : 0;
+	count = LuaIntDefault(L, 3, count);
+
+	const unsigned int* indices = LuaHandleArray(L, 1, count);
+	const float* volumes = nullptr;
+
+	if (lua_islightuserdata(L, 2))
+	{
+		volumes = static_cast<const float*>(lua_touserdata(L, 2));
+	}
+	else if (lua_istable(L, 2))
+	{
+		busVolumeScratch.resize(count);
+
+		for (int i = 0; i < count; i++)
+		{
+			lua_rawgeti(L, 2, i + 1);
+			busVolumeScratch[i] = static_cast<float>(lua_tonumber(L, -1));
+			lua_pop(L, 1);
+		}
+
+		volumes = busVolumeScratch.data();
+	}
+
+	lua_pushinteger(L, SetBusVolumes(indices, volumes, count));
+	return 1;
+}
+
+static int love_fmod_get_vca(lua_State* L)
+{
+	const char* input = lua_tostring(L, 1);
+	int result = GetVCA(input);
+	lua_pushinteger(L, result);
+	return 1;
+}
+
+static int love_fmod_get_vca_volume(lua_State* L)
+{
+	int index = static_cast<int>(lua_tointeger(L, 1));
+	float volume = GetVCAVolume(index);
+	lua_Number result = static_cast<lua_Number>(volume);
+	lua_pushnumber(L, result);
 	return 1;
 }
 
-static int love_fmod_release_instance(lua_State* L)
+static int love_fmod_set_vca_volume(lua_State* L)
 {
 	int index = static_cast<int>(lua_tointeger(L, 1));
-	bool result = ReleaseInstance(index);
+	float volume = static_cast<float>(lua_tonumber(L, 2));
+	bool result = SetVCAVolume(index, volume);
 	lua_pushboolean(L, result);
 	return 1;
 }
 
-static int love_fmod_set3d_attributes(lua_State* L)
+// Instance objects returned by fmod.newInstance. The userdata holds the
+// EventInstance pointer directly, so methods skip the handle table, and __gc
+// releases the instance once Lua drops the last reference to it.
+#define LUA_INSTANCE_METATABLE "fmodlove.Instance"
+
+struct LuaInstance {
+	FMOD::Studio::EventInstance* instance;
+};
+
+static FMOD::Studio::EventInstance* LuaCheckInstance(lua_State* L, int index)
 {
-	int index = static_cast<int>(lua_tointeger(L, 1));
-	float posX = static_cast<float>(lua_tonumber(L, 2));
-	float posY = static_cast<float>(lua_tonumber(L, 3));
-	float posZ = static_cast<float>(lua_tonumber(L, 4));
-	float dirX = static_cast<float>(lua_tonumber(L, 5));
-	float dirY = static_cast<float>(lua_tonumber(L, 6));
-	float dirZ = static_cast<float>(lua_tonumber(L, 7));
-	float oX = static_cast<float>(lua_tonumber(L, 8));
-	float oY = static_cast<float>(lua_tonumber(L, 9));
-	float oZ = static_cast<float>(lua_tonumber(L, 10));
+	auto object = static_cast<LuaInstance*>(luaL_checkudata(L, index, LUA_INSTANCE_METATABLE));
+	return object->instance;
+}
 
-	bool result = Set3DAttributes(index, posX, posY, posZ, dirX, dirY, dirZ, oX, oY, oZ);
-	lua_pushboolean(L, result);
+// Accepts either an instance object or an instance index value.
+static FMOD::Studio::EventInstance* LuaToInstance(lua_State* L, int index)
+{
+	if (lua_isuserdata(L, index) && !lua_islightuserdata(L, index))
+	{
+		return LuaCheckInstance(L, index);
+	}
+
+	return instanceList.Get(static_cast<unsigned int>(lua_tointeger(L, index)));
+}
+
+static int love_fmod_add_instance_meter(lua_State* L)
+{
+	lua_pushinteger(L, AddInstanceMeter(LuaToInstance(L, 1)));
 	return 1;
 }
 
-static int love_fmod_playoneshot2d(lua_State* L)
+// The tag defaults to the instance index value, or 0 for instance objects.
+static int love_fmod_set_event_callback(lua_State* L)
+{
+	auto instance = LuaToInstance(L, 1);
+	int mask = LuaIntDefault(L, 2, static_cast<int>(EventCallbackMask));
+	int tag = LuaIntDefault(L, 3, lua_isnumber(L, 1) ? static_cast<int>(lua_tointeger(L, 1)) : 0);
+	lua_pushboolean(L, SetEventCallback(instance, static_cast<FMOD_STUDIO_EVENT_CALLBACK_TYPE>(mask), tag));
+	return 1;
+}
+
+static int love_fmod_add_instance_spectrum(lua_State* L)
+{
+	auto instance = LuaToInstance(L, 1);
+	int windowSize = LuaIntDefault(L, 2, 2048);
+	int bandCount = LuaIntDefault(L, 3, 64);
+	lua_pushinteger(L, AddInstanceSpectrum(instance, windowSize, bandCount));
+	return 1;
+}
+
+static int love_fmod_add_bus_meter(lua_State* L)
+{
+	unsigned int index = static_cast<unsigned int>(lua_tointeger(L, 1));
+	lua_pushinteger(L, AddBusMeter(index));
+	return 1;
+}
+
+static int love_fmod_remove_meter(lua_State* L)
+{
+	unsigned int index = static_cast<unsigned int>(lua_tointeger(L, 1));
+	lua_pushboolean(L, RemoveMeter(index));
+	return 1;
+}
+
+static int love_fmod_get_meter_level(lua_State* L)
+{
+	unsigned int index = static_cast<unsigned int>(lua_tointeger(L, 1));
+	float levels[2];
+	GetMeterLevels(&index, levels, 1);
+	lua_pushnumber(L, static_cast<lua_Number>(levels[0]));
+	lua_pushnumber(L, static_cast<lua_Number>(levels[1]));
+	return 2;
+}
+
+static int love_fmod_new_instance(lua_State* L)
 {
 	const char* input = lua_tostring(L, 1);
-	bool result = PlayOneShot2D(input);
+	const EventInfo* eventInfo = GetEventInfo(input);
+
+	FMOD::Studio::EventInstance* eventInstance = nullptr;
+
+	if (!eventInfo || eventInfo->description->createInstance(&eventInstance) != FMOD_OK)
+	{
+		lua_pushnil(L);
+		return 1;
+	}
+
+	auto object = static_cast<LuaInstance*>(lua_newuserdata(L, sizeof(LuaInstance)));
+	object->instance = eventInstance;
+	luaL_getmetatable(L, LUA_INSTANCE_METATABLE);
+	lua_setmetatable(L, -2);
+	return 1;
+}
+
+static int love_fmod_instance_gc(lua_State* L)
+{
+	auto object = static_cast<LuaInstance*>(luaL_checkudata(L, 1, LUA_INSTANCE_METATABLE));
+
+	// The collector runs at any point in the frame, so recorded setters are
+	// not flushed from here. If there are any, the release waits for them.
+	if (object->instance && !deferredCommands.empty())
+	{
+		deferredReleases.push_back(object->instance);
+		object->instance = nullptr;
+	}
+	else if (object->instance)
+	{
+		object->instance->release();
+		ForgetSetterShadow(object->instance);
+		object->instance = nullptr;
+	}
+
+	return 0;
+}
+
+static int love_fmod_instance_release(lua_State* L)
+{
+	auto object = static_cast<LuaInstance*>(luaL_checkudata(L, 1, LUA_INSTANCE_METATABLE));
+	bool result = false;
+
+	if (object->instance)
+	{
+		FlushDeferredCommands();
+		result = ERROR_CHECK(object->instance->release());
+		ForgetSetterShadow(object->instance);
+		object->instance = nullptr;
+	}
+
 	lua_pushboolean(L, result);
 	return 1;
 }
 
-static int love_fmod_playoneshot3d(lua_State* L)
+static int love_fmod_instance_is_valid(lua_State* L)
 {
-	const char* input = lua_tostring(L, 1);
-	float posX = static_cast<float>(lua_tonumber(L, 2));
-	float posY = static_cast<float>(lua_tonumber(L, 3));
-	float posZ = static_cast<float>(lua_tonumber(L, 4));
-	float dirX = static_cast<float>(lua_tonumber(L, 5));
-	float dirY = static_cast<float>(lua_tonumber(L, 6));
-	float dirZ = static_cast<float>(lua_tonumber(L, 7));
-	float oX = static_cast<float>(lua_tonumber(L, 8));
-	float oY = static_cast<float>(lua_tonumber(L, 9));
-	float oZ = static_cast<float>(lua_tonumber(L, 10));
+	auto instance = LuaCheckInstance(L, 1);
+	lua_pushboolean(L, instance && instance->isValid());
+	return 1;
+}
 
-	bool result = PlayOneShot3D(input, posX, posY, posZ, dirX, dirY, dirZ, oX, oY, oZ);
+static int love_fmod_instance_start(lua_State* L)
+{
+	auto instance = LuaCheckInstance(L, 1);
+	FlushDeferredCommands();
+	bool result = instance && ERROR_CHECK(instance->start());
 	lua_pushboolean(L, result);
 	return 1;
 }
 
-static int love_fmod_set_instance_volume(lua_State* L)
+static int love_fmod_instance_stop(lua_State* L)
 {
-	int index = static_cast<int>(lua_tointeger(L, 1));
-	float volume = static_cast<float>(lua_tonumber(L, 2));
-	bool result = SetInstanceVolume(index, volume);
+	auto instance = LuaCheckInstance(L, 1);
+	int stopMode = static_cast<int>(lua_tointeger(L, 2));
+	FlushDeferredCommands();
+	bool result = instance && ERROR_CHECK(instance->stop((FMOD_STUDIO_STOP_MODE)(stopMode)));
 	lua_pushboolean(L, result);
 	return 1;
 }
 
-static int love_fmod_is_playing(lua_State* L)
+static int love_fmod_instance_set3d_attributes(lua_State* L)
 {
-	int index = static_cast<int>(lua_tointeger(L, 1));
-	bool result = IsPlaying(index);
+	auto instance = LuaCheckInstance(L, 1);
+	Vector3 pos = Vector3(static_cast<float>(lua_tonumber(L, 2)), static_cast<float>(lua_tonumber(L, 3)),
+		static_cast<float>(lua_tonumber(L, 4)));
+	Vector3 forward = Vector3(static_cast<float>(lua_tonumber(L, 5)), static_cast<float>(lua_tonumber(L, 6)),
+		static_cast<float>(lua_tonumber(L, 7)));
+	Vector3 up = Vector3(static_cast<float>(lua_tonumber(L, 8)), static_cast<float>(lua_tonumber(L, 9)),
+		static_cast<float>(lua_tonumber(L, 10)));
+
+	FMOD_3D_ATTRIBUTES attributes; To3DAttributes(pos, forward, up, attributes);
+
+	bool result = instance && ApplyInstance3DAttributes(instance, attributes);
 	lua_pushboolean(L, result);
 	return 1;
 }
 
-static int love_fmod_set_instance_paused(lua_State* L)
+static int love_fmod_instance_set_volume(lua_State* L)
 {
-	int index = static_cast<int>(lua_tointeger(L, 1));
+	auto instance = LuaCheckInstance(L, 1);
+	float volume = static_cast<float>(lua_tonumber(L, 2));
+
+	bool result = instance && ApplyInstanceVolume(instance, volume);
+	lua_pushboolean(L, result);
+	return 1;
+}
+
+static int love_fmod_instance_is_playing(lua_State* L)
+{
+	auto instance = LuaCheckInstance(L, 1);
+	lua_pushboolean(L, instance && InstanceIsPlaying(instance));
+	return 1;
+}
+
+static int love_fmod_instance_set_paused(lua_State* L)
+{
+	auto instance = LuaCheckInstance(L, 1);
 	bool paused = lua_toboolean(L, 2);
-	bool result = SetInstancePaused(index, paused);
+
+	bool result = instance && ApplyInstancePaused(instance, paused);
 	lua_pushboolean(L, result);
 	return 1;
 }
 
-static int love_fmod_get_instance_pitch(lua_State* L)
+static int love_fmod_instance_get_pitch(lua_State* L)
 {
-	int index = static_cast<int>(lua_tointeger(L, 1));
-	float pitch = GetInstancePitch(index);
-	lua_Number result = static_cast<lua_Number>(pitch);
-	lua_pushnumber(L, result);
+	auto instance = LuaCheckInstance(L, 1);
+	float pitch = 0, finalPitch = -1.f;
+
+	if (!instance || instance->getPitch(&pitch, &finalPitch) != FMOD_OK)
+	{
+		finalPitch = -1.f;
+	}
+
+	lua_pushnumber(L, static_cast<lua_Number>(finalPitch));
 	return 1;
 }
 
-static int love_fmod_set_instance_pitch(lua_State* L)
+static int love_fmod_instance_set_pitch(lua_State* L)
 {
-	int index = static_cast<int>(lua_tointeger(L, 1));
+	auto instance = LuaCheckInstance(L, 1);
 	float pitch = static_cast<float>(lua_tonumber(L, 2));
-	bool result = SetInstancePitch(index, pitch);
+
+	bool result = instance && ApplyInstancePitch(instance, pitch);
 	lua_pushboolean(L, result);
 	return 1;
 }
 
-static int love_fmod_get_timeline_position(lua_State* L)
+static int love_fmod_instance_get_timeline_position(lua_State* L)
 {
-	int index = static_cast<int>(lua_tointeger(L, 1));
-	int position = GetTimelinePosition(index);
+	auto instance = LuaCheckInstance(L, 1);
+	int position = -1;
+
+	if (!instance || instance->getTimelinePosition(&position) != FMOD_OK)
+	{
+		position = -1;
+	}
+
 	lua_pushinteger(L, position);
 	return 1;
 }
 
-static int love_fmod_set_timeline_position(lua_State* L)
+static int love_fmod_instance_set_timeline_position(lua_State* L)
 {
-	int index = static_cast<int>(lua_tointeger(L, 1));
+	auto instance = LuaCheckInstance(L, 1);
 	int position = static_cast<int>(lua_tointeger(L, 2));
-	bool result = SetTimelinePosition(index, position);
+
+	bool result = instance && ApplyTimelinePosition(instance, position);
 	lua_pushboolean(L, result);
 	return 1;
 }
 
-static int love_fmod_get_instance_rms(lua_State* L)
+static int love_fmod_instance_get_rms(lua_State* L)
 {
-	int index = static_cast<int>(lua_tointeger(L, 1));
-	float rms = GetInstanceRMS(index);
-	lua_Number result = static_cast<lua_Number>(rms);
-	lua_pushnumber(L, result);
+	auto instance = LuaCheckInstance(L, 1);
+	float rms = instance ? InstanceRMS(instance) : -1.f;
+	lua_pushnumber(L, static_cast<lua_Number>(rms));
+	return 1;
+}
+
+// Takes either a parameter name or an ID from fmod.getParameterId.
+static int love_fmod_instance_get_parameter(lua_State* L)
+{
+	auto instance = LuaCheckInstance(L, 1);
+	float value, finalValue = -1.f;
+	FMOD_RESULT result = FMOD_ERR_INVALID_HANDLE;
+
+	if (instance && lua_type(L, 2) == LUA_TSTRING)
+	{
+		result = instance->getParameterByName(lua_tostring(L, 2), &value, &finalValue);
+	}
+	else if (instance)
+	{
+		auto id = GetInternedParameterID(static_cast<unsigned int>(lua_tointeger(L, 2)));
+		if (id)
+		{
+			result = instance->getParameterByID(*id, &value, &finalValue);
+		}
+	}
+
+	if (result != FMOD_OK)
+	{
+		finalValue = -1.f;
+	}
+
+	lua_pushnumber(L, static_cast<lua_Number>(finalValue));
+	return 1;
+}
+
+// Takes either a parameter name or an ID from fmod.getParameterId.
+static int love_fmod_instance_set_parameter(lua_State* L)
+{
+	auto instance = LuaCheckInstance(L, 1);
+	float value = static_cast<float>(lua_tonumber(L, 3));
+	bool ignoreSeekSpeed = lua_toboolean(L, 4);
+	bool result = false;
+
+	if (instance && lua_type(L, 2) == LUA_TSTRING)
+	{
+		result = ApplyParameterByName(instance, lua_tostring(L, 2), value, ignoreSeekSpeed);
+	}
+	else if (instance)
+	{
+		auto id = GetInternedParameterID(static_cast<unsigned int>(lua_tointeger(L, 2)));
+		result = id && ApplyParameters(instance, id, &value, 1, ignoreSeekSpeed);
+	}
+
+	lua_pushboolean(L, result);
+	return 1;
+}
+
+static int love_fmod_instance_set_parameters(lua_State* L)
+{
+	auto instance = LuaCheckInstance(L, 1);
+	int count = LuaReadParameterTables(L, 2, 3);
+	bool ignoreSeekSpeed = lua_toboolean(L, 4);
+	bool result = instance && count > 0 && ApplyParametersByIDs(instance, parameterIdScratch.data(),
+		parameterValueScratch.data(), count, ignoreSeekSpeed);
+
+	lua_pushboolean(L, result);
+	return 1;
+}
+
+static const struct luaL_reg love_fmod_instance_methods[] = {
+	{ "start", love_fmod_instance_start },
+	{ "stop", love_fmod_instance_stop },
+	{ "release", love_fmod_instance_release },
+	{ "isValid", love_fmod_instance_is_valid },
+	{ "set3DAttributes", love_fmod_instance_set3d_attributes },
+	{ "setVolume", love_fmod_instance_set_volume },
+	{ "isPlaying", love_fmod_instance_is_playing },
+	{ "setPaused", love_fmod_instance_set_paused },
+	{ "getPitch", love_fmod_instance_get_pitch },
+	{ "setPitch", love_fmod_instance_set_pitch },
+	{ "getTimelinePosition", love_fmod_instance_get_timeline_position },
+	{ "setTimelinePosition", love_fmod_instance_set_timeline_position },
+	{ "getRms", love_fmod_instance_get_rms },
+	{ "getParameter", love_fmod_instance_get_parameter },
+	{ "setParameter", love_fmod_instance_set_parameter },
+	{ "setParameters", love_fmod_instance_set_parameters },
+	{ NULL, NULL }
+};
+
+static void RegisterInstanceMetatable(lua_State* L)
+{
+	luaL_newmetatable(L, LUA_INSTANCE_METATABLE);
+	lua_pushvalue(L, -1);
+	lua_setfield(L, -2, "__index");
+	lua_pushcfunction(L, love_fmod_instance_gc);
+	lua_setfield(L, -2, "__gc");
+	luaL_register(L, NULL, love_fmod_instance_methods);
+	lua_pop(L, 1);
+}
+
+// Pool objects returned by fmod.createPool. __gc releases every instance in
+// the pool.
+#define LUA_POOL_METATABLE "fmodlove.Pool"
+
+struct LuaPool {
+	InstancePool* pool;
+};
+
+static InstancePool* LuaCheckPool(lua_State* L, int index)
+{
+	auto object = static_cast<LuaPool*>(luaL_checkudata(L, index, LUA_POOL_METATABLE));
+	return object->pool;
+}
+
+static int love_fmod_create_pool(lua_State* L)
+{
+	const char* input = lua_tostring(L, 1);
+	int size = LuaIntDefault(L, 2, 8);
+	int stealMode = LuaIntDefault(L, 3, POOL_STEAL_OLDEST);
+
+	InstancePool* pool = CreatePool(input, size, static_cast<PoolStealMode>(stealMode));
+
+	if (!pool)
+	{
+		lua_pushnil(L);
+		return 1;
+	}
+
+	auto object = static_cast<LuaPool*>(lua_newuserdata(L, sizeof(LuaPool)));
+	object->pool = pool;
+	luaL_getmetatable(L, LUA_POOL_METATABLE);
+	lua_setmetatable(L, -2);
+	return 1;
+}
+
+static int love_fmod_pool_gc(lua_State* L)
+{
+	auto object = static_cast<LuaPool*>(luaL_checkudata(L, 1, LUA_POOL_METATABLE));
+	ReleasePool(object->pool);
+	object->pool = nullptr;
+	return 0;
+}
+
+static int love_fmod_pool_play(lua_State* L)
+{
+	auto pool = LuaCheckPool(L, 1);
+
+	Vector3 pos = Vector3(LuaNumberDefault(L, 2, 0.f), LuaNumberDefault(L, 3, 0.f), LuaNumberDefault(L, 4, 0.f));
+	Vector3 forward = Vector3(LuaNumberDefault(L, 5, 0.f), LuaNumberDefault(L, 6, 0.f), LuaNumberDefault(L, 7, 1.f));
+	Vector3 up = Vector3(LuaNumberDefault(L, 8, 0.f), LuaNumberDefault(L, 9, 1.f), LuaNumberDefault(L, 10, 0.f));
+
+	FMOD_3D_ATTRIBUTES attributes; To3DAttributes(pos, forward, up, attributes);
+
+	lua_pushboolean(L, PlayPool(pool, attributes));
+	return 1;
+}
+
+static int love_fmod_pool_stop(lua_State* L)
+{
+	auto pool = LuaCheckPool(L, 1);
+	int stopMode = static_cast<int>(lua_tointeger(L, 2));
+	lua_pushboolean(L, StopPool(pool, stopMode));
+	return 1;
+}
+
+static int love_fmod_pool_get_size(lua_State* L)
+{
+	auto pool = LuaCheckPool(L, 1);
+	lua_pushinteger(L, pool ? static_cast<lua_Integer>(pool->instances.size()) : -1);
+	return 1;
+}
+
+static int love_fmod_pool_get_active_count(lua_State* L)
+{
+	auto pool = LuaCheckPool(L, 1);
+	lua_pushinteger(L, GetPoolActiveCount(pool));
+	return 1;
+}
+
+static int love_fmod_pool_release(lua_State* L)
+{
+	auto object = static_cast<LuaPool*>(luaL_checkudata(L, 1, LUA_POOL_METATABLE));
+	bool result = object->pool != nullptr;
+	ReleasePool(object->pool);
+	object->pool = nullptr;
+	lua_pushboolean(L, result);
 	return 1;
 }
 
-static int love_fmod_get_global_parameter_by_name(lua_State* L)
-{
-	const char* input = lua_tostring(L, 1);
-	float parameterValue = GetGlobalParameterByName(input);
-	lua_Number result = static_cast<lua_Number>(parameterValue);
-	lua_pushnumber(L, result);
-	return 1;
+static const struct luaL_reg love_fmod_pool_methods[] = {
+	{ "play", love_fmod_pool_play },
+	{ "stop", love_fmod_pool_stop },
+	{ "getSize", love_fmod_pool_get_size },
+	{ "getActiveCount", love_fmod_pool_get_active_count },
+	{ "release", love_fmod_pool_release },
+	{ NULL, NULL }
+};
+
+static void RegisterPoolMetatable(lua_State* L)
+{
+	luaL_newmetatable(L, LUA_POOL_METATABLE);
+	lua_pushvalue(L, -1);
+	lua_setfield(L, -2, "__index");
+	lua_pushcfunction(L, love_fmod_pool_gc);
+	lua_setfield(L, -2, "__gc");
+	luaL_register(L, NULL, love_fmod_pool_methods);
+	lua_pop(L, 1);
+}
+
+static int love_fmod_set_deferred_mode(lua_State* L)
+{
+	SetDeferredMode(lua_toboolean(L, 1));
+	return 0;
+}
+
+static int love_fmod_flush_commands(lua_State* L)
+{
+	FlushDeferredCommands();
+	return 0;
+}
+
+// Takes an optional table of epsilons keyed by field name.
+static int love_fmod_set_dirty_tracking(lua_State* L)
+{
+	static const char* fieldNames[DIRTY_EPSILON_COUNT] = {
+		"volume", "pitch", "parameter", "position", "velocity", "orientation"
+	};
+
+	if (lua_istable(L, 2))
+	{
+		for (int field = 0; field < DIRTY_EPSILON_COUNT; field++)
+		{
+			lua_getfield(L, 2, fieldNames[field]);
+			if (lua_isnumber(L, -1))
+			{
+				SetDirtyEpsilon(static_cast<DirtyEpsilon>(field), static_cast<float>(lua_tonumber(L, -1)));
+			}
+			lua_pop(L, 1);
+		}
+	}
+
+	SetDirtyTracking(lua_toboolean(L, 1));
+	return 0;
 }
 
-static int love_fmod_set_global_parameter_by_name(lua_State* L)
+// Records every Studio API call to a file that Studio's profiler, or the
+// replay benchmark, can play back.
+static int love_fmod_start_command_capture(lua_State* L)
 {
-	const char* input = lua_tostring(L, 1);
-	float parameterValue = static_cast<float>(lua_tonumber(L, 2));
-	bool ignoreSeekSpeed = lua_toboolean(L, 3);
-	bool result = SetGlobalParameterByName(input, parameterValue, ignoreSeekSpeed);
+	const char* path = luaL_checkstring(L, 1);
+	FMOD_STUDIO_COMMANDCAPTURE_FLAGS flags = lua_toboolean(L, 2) ? FMOD_STUDIO_COMMANDCAPTURE_FILEFLUSH :
+		FMOD_STUDIO_COMMANDCAPTURE_NORMAL;
+
+	bool result = studioSystem && ERROR_CHECK(studioSystem->startCommandCapture(path, flags));
 	lua_pushboolean(L, result);
 	return 1;
 }
 
-static int love_fmod_get_parameter_by_name(lua_State* L)
+static int love_fmod_stop_command_capture(lua_State* L)
 {
-	int index = static_cast<int>(lua_tointeger(L, 1));
-	const char* input = lua_tostring(L, 2);
-	float parameterValue = GetParameterByName(index, input);
-	lua_Number result = static_cast<lua_Number>(parameterValue);
-	lua_pushnumber(L, result);
+	bool result = studioSystem && ERROR_CHECK(studioSystem->stopCommandCapture());
+	lua_pushboolean(L, result);
 	return 1;
 }
 
-static int love_fmod_set_parameter_by_name(lua_State* L)
+static void RegisterBindings(lua_State* L);
+
+static int love_fmod_set_profiling(lua_State* L)
 {
-	int index = static_cast<int>(lua_tointeger(L, 1));
-	const char* input = lua_tostring(L, 2);
-	float parameterValue = static_cast<float>(lua_tonumber(L, 3));
-	bool ignoreSeekSpeed = lua_toboolean(L, 4);
-	bool result = SetParameterByName(index, input, parameterValue, ignoreSeekSpeed);
-	lua_pushboolean(L, result);
-	return 1;
+	bool enabled = lua_toboolean(L, 1);
+
+	if (enabled != profilingEnabled)
+	{
+		profilingEnabled = enabled;
+		RegisterBindings(L);
+	}
+
+	return 0;
 }
 
-static int love_fmod_get_bus(lua_State* L)
+static void ResetBindingStats()
 {
-	const char* input = lua_tostring(L, 1);
-	int result = GetBus(input);
-	lua_pushinteger(L, result);
-	return 1;
+	for (auto& stats : bindingStats)
+	{
+		stats.calls = 0;
+		stats.totalNanoseconds = 0;
+		stats.maxNanoseconds = 0;
+		std::fill(std::begin(stats.buckets), std::end(stats.buckets), 0);
+	}
+
+	for (auto& counter : resultCounters)
+	{
+		counter.store(0, std::memory_order_relaxed);
+	}
+
+	deferredRecorded = 0;
+	deferredMerged = 0;
+	suppressedSetters = 0;
+	eventCallbacksDropped = 0;
+	reapedInstances = 0;
+	emitterCulls = 0;
+	sampleLoads = 0;
+	sampleEvictions = 0;
 }
 
-static int love_fmod_get_bus_volume(lua_State* L)
+static int love_fmod_reset_stats(lua_State* L)
 {
-	int index = static_cast<int>(lua_tointeger(L, 1));
-	float volume = GetBusVolume(index);
-	lua_Number result = static_cast<lua_Number>(volume);
-	lua_pushnumber(L, result);
-	return 1;
+	ResetBindingStats();
+	return 0;
 }
 
-static int love_fmod_set_bus_volume(lua_State* L)
+// Upper bound, in milliseconds, of the histogram bucket holding the given
+// fraction of calls.
+static double LatencyPercentile(const BindingStats& stats, double fraction)
 {
-	int index = static_cast<int>(lua_tointeger(L, 1));
-	float volume = static_cast<float>(lua_tonumber(L, 2));
-	bool result = SetBusVolume(index, volume);
-	lua_pushboolean(L, result);
-	return 1;
+	long long target = static_cast<long long>(std::ceil(fraction * static_cast<double>(stats.calls)));
+	long long seen = 0;
+
+	for (int bucket = 0; bucket < LatencyBucketCount; bucket++)
+	{
+		seen += stats.buckets[bucket];
+
+		if (seen >= target)
+		{
+			return std::ldexp(1.0, bucket + 1) / 1e6;
+		}
+	}
+
+	return static_cast<double>(stats.maxNanoseconds) / 1e6;
 }
 
-static int love_fmod_get_vca(lua_State* L)
+static void LuaSetNumberField(lua_State* L, const char* name, double value)
 {
-	const char* input = lua_tostring(L, 1);
-	int result = GetVCA(input);
-	lua_pushinteger(L, result);
-	return 1;
+	lua_pushnumber(L, static_cast<lua_Number>(value));
+	lua_setfield(L, -2, name);
 }
 
-static int love_fmod_get_vca_volume(lua_State* L)
+static void LuaPushBufferInfo(lua_State* L, const FMOD_STUDIO_BUFFER_INFO& info)
 {
-	int index = static_cast<int>(lua_tointeger(L, 1));
-	float volume = GetVCAVolume(index);
-	lua_Number result = static_cast<lua_Number>(volume);
-	lua_pushnumber(L, result);
-	return 1;
+	lua_createtable(L, 0, 5);
+	LuaSetNumberField(L, "current", info.currentusage);
+	LuaSetNumberField(L, "peak", info.peakusage);
+	LuaSetNumberField(L, "capacity", info.capacity);
+	LuaSetNumberField(L, "stalls", info.stallcount);
+	LuaSetNumberField(L, "stallTime", info.stalltime);
 }
 
-static int love_fmod_set_vca_volume(lua_State* L)
+// Returns binding call statistics, error counts and FMOD's own CPU, command
+// buffer and channel usage in one table.
+static int love_fmod_get_stats(lua_State* L)
 {
-	int index = static_cast<int>(lua_tointeger(L, 1));
-	float volume = static_cast<float>(lua_tonumber(L, 2));
-	bool result = SetVCAVolume(index, volume);
-	lua_pushboolean(L, result);
+	lua_createtable(L, 0, 6);
+
+	lua_createtable(L, 0, static_cast<int>(bindingStats.size()));
+	for (const auto& stats : bindingStats)
+	{
+		if (stats.calls == 0)
+		{
+			continue;
+		}
+
+		lua_createtable(L, 0, 7);
+		LuaSetNumberField(L, "calls", static_cast<double>(stats.calls));
+		LuaSetNumberField(L, "totalMs", static_cast<double>(stats.totalNanoseconds) / 1e6);
+		LuaSetNumberField(L, "maxMs", static_cast<double>(stats.maxNanoseconds) / 1e6);
+		LuaSetNumberField(L, "p50Ms", LatencyPercentile(stats, 0.5));
+		LuaSetNumberField(L, "p95Ms", LatencyPercentile(stats, 0.95));
+		LuaSetNumberField(L, "p99Ms", LatencyPercentile(stats, 0.99));
+
+		lua_createtable(L, LatencyBucketCount, 0);
+		for (int bucket = 0; bucket < LatencyBucketCount; bucket++)
+		{
+			lua_pushnumber(L, static_cast<lua_Number>(stats.buckets[bucket]));
+			lua_rawseti(L, -2, bucket + 1);
+		}
+		lua_setfield(L, -2, "histogram");
+
+		lua_setfield(L, -2, stats.name);
+	}
+	lua_setfield(L, -2, "calls");
+
+	lua_newtable(L);
+	for (int code = 0; code < ResultCounterCount; code++)
+	{
+		long long count = resultCounters[code].load(std::memory_order_relaxed);
+
+		if (count > 0)
+		{
+			lua_pushnumber(L, static_cast<lua_Number>(count));
+			lua_rawseti(L, -2, code);
+		}
+	}
+	lua_setfield(L, -2, "errors");
+
+	lua_createtable(L, 0, 3);
+	LuaSetNumberField(L, "recorded", static_cast<double>(deferredRecorded));
+	LuaSetNumberField(L, "merged", static_cast<double>(deferredMerged));
+	LuaSetNumberField(L, "pending", static_cast<double>(deferredCommands.size()));
+	lua_setfield(L, -2, "deferred");
+
+	lua_createtable(L, 0, 2);
+	LuaSetNumberField(L, "suppressed", static_cast<double>(suppressedSetters));
+	LuaSetNumberField(L, "shadows", static_cast<double>(setterShadows.size()));
+	lua_setfield(L, -2, "dirty");
+
+	lua_createtable(L, 0, 1);
+	LuaSetNumberField(L, "dropped", static_cast<double>(eventCallbacksDropped.load()));
+	lua_setfield(L, -2, "callbacks");
+
+	if (studioSystem && coreSystem)
+	{
+		FMOD_STUDIO_CPU_USAGE usage = {};
+		studioSystem->getCPUUsage(&usage);
+
+		lua_createtable(L, 0, 5);
+		LuaSetNumberField(L, "dsp", usage.dspusage);
+		LuaSetNumberField(L, "stream", usage.streamusage);
+		LuaSetNumberField(L, "geometry", usage.geometryusage);
+		LuaSetNumberField(L, "update", usage.updateusage);
+		LuaSetNumberField(L, "studio", usage.studiousage);
+		lua_setfield(L, -2, "cpu");
+
+		FMOD_STUDIO_BUFFER_USAGE bufferUsage = {};
+		studioSystem->getBufferUsage(&bufferUsage);
+
+		LuaPushBufferInfo(L, bufferUsage.studiocommandqueue);
+		lua_setfield(L, -2, "commandQueue");
+		LuaPushBufferInfo(L, bufferUsage.studiohandle);
+		lua_setfield(L, -2, "handles");
+
+		int channels = 0, realChannels = 0;
+		coreSystem->getChannelsPlaying(&channels, &realChannels);
+
+		lua_createtable(L, 0, 3);
+		LuaSetNumberField(L, "playing", channels);
+		LuaSetNumberField(L, "real", realChannels);
+		LuaSetNumberField(L, "virtual", channels - realChannels);
+		lua_setfield(L, -2, "channels");
+
+		lua_createtable(L, 0, 3);
+		LuaSetNumberField(L, "live", static_cast<double>(instanceList.Size()));
+		LuaSetNumberField(L, "autoRelease", static_cast<double>(autoReleaseInstances.size()));
+		LuaSetNumberField(L, "reaped", static_cast<double>(reapedInstances));
+		lua_setfield(L, -2, "instances");
+
+		lua_createtable(L, 0, 3);
+		LuaSetNumberField(L, "total", static_cast<double>(emitterList.Size()));
+		LuaSetNumberField(L, "audible", static_cast<double>(audibleEmitters.size()));
+		LuaSetNumberField(L, "culls", static_cast<double>(emitterCulls));
+		lua_setfield(L, -2, "emitters");
+	}
+
+	lua_createtable(L, 0, 5);
+	LuaSetNumberField(L, "events", static_cast<double>(sampleResidency.size()));
+	LuaSetNumberField(L, "bytes", static_cast<double>(residentSampleBytes));
+	LuaSetNumberField(L, "budget", static_cast<double>(sampleBudget));
+	LuaSetNumberField(L, "loads", static_cast<double>(sampleLoads));
+	LuaSetNumberField(L, "evictions", static_cast<double>(sampleEvictions));
+	lua_setfield(L, -2, "samples");
+
 	return 1;
 }
 
 static const struct luaL_reg love_fmod_methods[] = {
 	{ "init", love_fmod_init },
 	{ "update", love_fmod_update },
+	{ "getMemoryStats", love_fmod_get_memory_stats },
+	{ "getLatencyInfo", love_fmod_get_latency_info },
+	{ "getOfflineCapture", love_fmod_get_offline_capture },
+	{ "resetOfflineCapture", love_fmod_reset_offline_capture },
+	{ "setDeferredMode", love_fmod_set_deferred_mode },
+	{ "flushCommands", love_fmod_flush_commands },
+	{ "setDirtyTracking", love_fmod_set_dirty_tracking },
+	{ "startCommandCapture", love_fmod_start_command_capture },
+	{ "stopCommandCapture", love_fmod_stop_command_capture },
+	{ "setProfiling", love_fmod_set_profiling },
+	{ "getStats", love_fmod_get_stats },
+	{ "resetStats", love_fmod_reset_stats },
 	{ "loadBank", love_fmod_load_bank },
 	{ "unloadBank", love_fmod_unload_bank },
+	{ "loadBankAsync", love_fmod_load_bank_async },
+	{ "getBankLoadingState", love_fmod_get_bank_loading_state },
+	{ "loadBankSampleData", love_fmod_load_bank_sample_data },
+	{ "unloadBankSampleData", love_fmod_unload_bank_sample_data },
+	{ "getBankLoadProgress", love_fmod_get_bank_load_progress },
+	{ "getLoadingProgress", love_fmod_get_loading_progress },
+	{ "setSampleBudget", love_fmod_set_sample_budget },
+	{ "prefetchSampleData", love_fmod_prefetch_sample_data },
+	{ "retainSampleData", love_fmod_retain_sample_data },
+	{ "releaseSampleData", love_fmod_release_sample_data },
+	{ "getSampleDataState", love_fmod_get_sample_data_state },
+	{ "getBankEvents", love_fmod_get_bank_events },
+	{ "setEventCallback", love_fmod_set_event_callback },
+	{ "getEventCallbacks", love_fmod_get_event_callbacks },
 	{ "setNumListeners", love_fmod_setnumlisteners },
 	{ "setListener3DPosition", love_fmod_set_listener3d_position },
 	{ "createInstance", love_fmod_create_instance },
+	{ "newInstance", love_fmod_new_instance },
 	{ "startInstance", love_fmod_start_instance },
 	{ "stopInstance", love_fmod_stop_instance },
 	{ "releaseInstance", love_fmod_release_instance },
+	{ "setInstanceAutoRelease", love_fmod_set_instance_auto_release },
+	{ "isInstanceValid", love_fmod_is_instance_valid },
 	{ "set3DAttributes", love_fmod_set3d_attributes },
+	{ "set3DAttributesBatch", love_fmod_set3d_attributes_batch },
+	{ "createEmitter", love_fmod_create_emitter },
+	{ "setEmitterPosition", love_fmod_set_emitter_position },
+	{ "setEmitterPositions", love_fmod_set_emitter_positions },
+	{ "releaseEmitter", love_fmod_release_emitter },
+	{ "isEmitterAudible", love_fmod_is_emitter_audible },
+	{ "setEmitterCellSize", love_fmod_set_emitter_cell_size },
+	{ "setMotionSmoothing", love_fmod_set_motion_smoothing },
+	{ "setMotionInterpolation", love_fmod_set_motion_interpolation },
+	{ "createPool", love_fmod_create_pool },
 	{ "playOneShot2D", love_fmod_playoneshot2d },
 	{ "playOneShot3D", love_fmod_playoneshot3d },
+	{ "setOneShotCoalescing", love_fmod_set_one_shot_coalescing },
+	{ "setOneShotRateLimit", love_fmod_set_one_shot_rate_limit },
 	{ "setInstanceVolume", love_fmod_set_instance_volume },
 	{ "isPlaying", love_fmod_is_playing },
 	{ "setInstancePaused", love_fmod_set_instance_paused },
@@ -971,31 +6680,316 @@ static const struct luaL_reg love_fmod_methods[] = {
 	{ "getTimelinePosition", love_fmod_get_timeline_position },
 	{ "setTimelinePosition", love_fmod_set_timeline_position },
 	{ "getInstanceRms", love_fmod_get_instance_rms },
+	{ "addInstanceMeter", love_fmod_add_instance_meter },
+	{ "addBusMeter", love_fmod_add_bus_meter },
+	{ "removeMeter", love_fmod_remove_meter },
+	{ "getMeterLevel", love_fmod_get_meter_level },
+	{ "getMeterLevels", love_fmod_get_meter_levels },
+	{ "addInstanceSpectrum", love_fmod_add_instance_spectrum },
+	{ "addBusSpectrum", love_fmod_add_bus_spectrum },
+	{ "removeSpectrum", love_fmod_remove_spectrum },
+	{ "getSpectrum", love_fmod_get_spectrum },
 	{ "getGlobalParameterByName", love_fmod_get_global_parameter_by_name },
 	{ "setGlobalParameterByName", love_fmod_set_global_parameter_by_name },
 	{ "getParameterByName", love_fmod_get_parameter_by_name },
 	{ "setParameterByName", love_fmod_set_parameter_by_name },
+	{ "getParameterId", love_fmod_get_parameter_id },
+	{ "getGlobalParameterId", love_fmod_get_global_parameter_id },
+	{ "getParameterByID", love_fmod_get_parameter_by_id },
+	{ "setParameterByID", love_fmod_set_parameter_by_id },
+	{ "setParametersByIDs", love_fmod_set_parameters_by_ids },
+	{ "getGlobalParameterByID", love_fmod_get_global_parameter_by_id },
+	{ "setGlobalParameterByID", love_fmod_set_global_parameter_by_id },
+	{ "setGlobalParametersByIDs", love_fmod_set_global_parameters_by_ids },
 	{ "getBus", love_fmod_get_bus },
 	{ "getBusVolume", love_fmod_get_bus_volume },
 	{ "setBusVolume", love_fmod_set_bus_volume },
+	{ "getBusVolumes", love_fmod_get_bus_volumes },
+	{ "setBusVolumes", love_fmod_set_bus_volumes },
 	{ "getVCA", love_fmod_get_vca },
 	{ "getVCAVolume", love_fmod_get_vca_volume },
 	{ "setVCAVolume", love_fmod_set_vca_volume },
 	{ NULL, NULL }
 };
 
+extern "C" {
+
+	FMODLOVE_FFI bool fmodlove_update(void)
+	{
+		return Update();
+	}
+
+	FMODLOVE_FFI bool fmodlove_set_listener_3d_position(unsigned int listener, float posX, float posY, float posZ, float dirX, float dirY, float dirZ, float oX, float oY, float oZ)
+	{
+		return SetListener3DPosition(listener, posX, posY, posZ, dirX, dirY, dirZ, oX, oY, oZ);
+	}
+
+	FMODLOVE_FFI int fmodlove_create_instance(const char* eventPath, bool autoRelease)
+	{
+		int index = CreateInstance(eventPath);
+
+		if (index >= 0 && autoRelease)
+		{
+			SetInstanceAutoRelease(index, true);
+		}
+
+		return index;
+	}
+
+	FMODLOVE_FFI bool fmodlove_start_instance(unsigned int index)
+	{
+		return StartInstance(index);
+	}
+
+	FMODLOVE_FFI bool fmodlove_stop_instance(unsigned int index, int stopMode)
+	{
+		return StopInstance(index, stopMode);
+	}
+
+	FMODLOVE_FFI bool fmodlove_release_instance(unsigned int index)
+	{
+		return ReleaseInstance(index);
+	}
+
+	FMODLOVE_FFI bool fmodlove_set_3d_attributes(unsigned int index, float posX, float posY, float posZ, float dirX, float dirY, float dirZ, float oX, float oY, float oZ)
+	{
+		return Set3DAttributes(index, posX, posY, posZ, dirX, dirY, dirZ, oX, oY, oZ);
+	}
+
+	FMODLOVE_FFI int fmodlove_set_3d_attributes_batch(const unsigned int* indices, int count, const float* positions, const float* forwards, const float* ups, const float* velocities)
+	{
+		return Set3DAttributesBatch(indices, count, positions, forwards, ups, velocities);
+	}
+
+	FMODLOVE_FFI int fmodlove_get_meter_levels(const unsigned int* meters, float* levels, int count)
+	{
+		return GetMeterLevels(meters, levels, count);
+	}
+
+	FMODLOVE_FFI int fmodlove_get_spectrum(unsigned int spectrum, float* bands, int count)
+	{
+		return GetSpectrum(spectrum, bands, count);
+	}
+
+	FMODLOVE_FFI int fmodlove_set_emitter_positions(const unsigned int* emitters, int count, const float* positions)
+	{
+		return SetEmitterPositions(emitters, count, positions);
+	}
+
+	FMODLOVE_FFI bool fmodlove_play_one_shot_2d(const char* eventPath)
+	{
+		return PlayOneShot2D(eventPath);
+	}
+
+	FMODLOVE_FFI bool fmodlove_play_one_shot_3d(const char* eventPath, float posX, float posY, float posZ, float dirX, float dirY, float dirZ, float oX, float oY, float oZ)
+	{
+		return PlayOneShot3D(eventPath, posX, posY, posZ, dirX, dirY, dirZ, oX, oY, oZ);
+	}
+
+	FMODLOVE_FFI bool fmodlove_set_instance_volume(unsigned int index, float volume)
+	{
+		return SetInstanceVolume(index, volume);
+	}
+
+	FMODLOVE_FFI bool fmodlove_is_playing(unsigned int index)
+	{
+		return IsPlaying(index);
+	}
+
+	FMODLOVE_FFI bool fmodlove_set_instance_paused(unsigned int index, bool pause)
+	{
+		return SetInstancePaused(index, pause);
+	}
+
+	FMODLOVE_FFI bool fmodlove_set_instance_pitch(unsigned int index, float pitch)
+	{
+		return SetInstancePitch(index, pitch);
+	}
+
+	FMODLOVE_FFI float fmodlove_get_instance_pitch(unsigned int index)
+	{
+		return GetInstancePitch(index);
+	}
+
+	FMODLOVE_FFI int fmodlove_get_timeline_position(unsigned int index)
+	{
+		return GetTimelinePosition(index);
+	}
+
+	FMODLOVE_FFI bool fmodlove_set_timeline_position(unsigned int index, unsigned int position)
+	{
+		return SetTimelinePosition(index, position);
+	}
+
+	FMODLOVE_FFI float fmodlove_get_global_parameter_by_name(const char* parameterName)
+	{
+		return GetGlobalParameterByName(parameterName);
+	}
+
+	FMODLOVE_FFI bool fmodlove_set_global_parameter_by_name(const char* parameterName, float value, bool ignoreSeekSpeed)
+	{
+		return SetGlobalParameterByName(parameterName, value, ignoreSeekSpeed);
+	}
+
+	FMODLOVE_FFI float fmodlove_get_parameter_by_name(unsigned int index, const char* parameterName)
+	{
+		return GetParameterByName(index, parameterName);
+	}
+
+	FMODLOVE_FFI bool fmodlove_set_parameter_by_name(unsigned int index, const char* parameterName, float value, bool ignoreSeekSpeed)
+	{
+		return SetParameterByName(index, parameterName, value, ignoreSeekSpeed);
+	}
+
+	FMODLOVE_FFI float fmodlove_get_parameter_by_id(unsigned int index, unsigned int parameterId)
+	{
+		return GetParameterByID(index, parameterId);
+	}
+
+	FMODLOVE_FFI bool fmodlove_set_parameter_by_id(unsigned int index, unsigned int parameterId, float value, bool ignoreSeekSpeed)
+	{
+		return SetParameterByID(index, parameterId, value, ignoreSeekSpeed);
+	}
+
+	FMODLOVE_FFI bool fmodlove_set_parameters_by_ids(unsigned int index, const unsigned int* parameterIds, float* values, int count, bool ignoreSeekSpeed)
+	{
+		return SetParametersByIDs(index, parameterIds, values, count, ignoreSeekSpeed);
+	}
+
+	FMODLOVE_FFI float fmodlove_get_global_parameter_by_id(unsigned int parameterId)
+	{
+		return GetGlobalParameterByID(parameterId);
+	}
+
+	FMODLOVE_FFI bool fmodlove_set_global_parameter_by_id(unsigned int parameterId, float value, bool ignoreSeekSpeed)
+	{
+		return SetGlobalParameterByID(parameterId, value, ignoreSeekSpeed);
+	}
+
+	FMODLOVE_FFI bool fmodlove_set_global_parameters_by_ids(const unsigned int* parameterIds, float* values, int count, bool ignoreSeekSpeed)
+	{
+		return SetGlobalParametersByIDs(parameterIds, values, count, ignoreSeekSpeed);
+	}
+
+	FMODLOVE_FFI float fmodlove_get_bus_volume(unsigned int index)
+	{
+		return GetBusVolume(index);
+	}
+
+	FMODLOVE_FFI bool fmodlove_set_bus_volume(unsigned int index, float volume)
+	{
+		return SetBusVolume(index, volume);
+	}
+
+	FMODLOVE_FFI int fmodlove_get_bus_volumes(const unsigned int* indices, float* volumes, int count)
+	{
+		return GetBusVolumes(indices, volumes, count);
+	}
+
+	FMODLOVE_FFI int fmodlove_set_bus_volumes(const unsigned int* indices, const float* volumes, int count)
+	{
+		return SetBusVolumes(indices, volumes, count);
+	}
+
+	FMODLOVE_FFI float fmodlove_get_vca_volume(unsigned int index)
+	{
+		return GetVCAVolume(index);
+	}
+
+	FMODLOVE_FFI bool fmodlove_set_vca_volume(unsigned int index, float volume)
+	{
+		return SetVCAVolume(index, volume);
+	}
+
+}
+
+// While profiling is on, every binding is called through here to time the
+// call and record it in the binding's histogram.
+static int love_fmod_profiled_call(lua_State* L)
+{
+	BindingStats& stats = bindingStats[static_cast<std::size_t>(lua_tointeger(L, lua_upvalueindex(1)))];
+
+	auto start = std::chrono::steady_clock::now();
+	int results = stats.function(L);
+	auto elapsed = std::chrono::steady_clock::now() - start;
+
+	long long nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+	int bucket = 0;
+
+	while (bucket < LatencyBucketCount - 1 && (nanoseconds >> (bucket + 1)) > 0)
+	{
+		bucket++;
+	}
+
+	stats.calls++;
+	stats.totalNanoseconds += nanoseconds;
+	stats.maxNanoseconds = std::max(stats.maxNanoseconds, nanoseconds);
+	stats.buckets[bucket]++;
+
+	return results;
+}
+
+// Sets the module's functions to the plain bindings, or to profiled closures
+// while profiling is on, so the plain ones cost nothing extra.
+static void RegisterBindings(lua_State* L)
+{
+	lua_rawgeti(L, LUA_REGISTRYINDEX, moduleReference);
+
+	for (std::size_t i = 0; i < bindingStats.size(); i++)
+	{
+		if (profilingEnabled)
+		{
+			lua_pushinteger(L, static_cast<lua_Integer>(i));
+			lua_pushcclosure(L, love_fmod_profiled_call, 1);
+		}
+		else
+		{
+			lua_pushcfunction(L, bindingStats[i].function);
+		}
+
+		lua_setfield(L, -2, bindingStats[i].name);
+	}
+
+	lua_pop(L, 1);
+}
+
+static void OpenModule(lua_State* L, const char* name)
+{
+	static const struct luaL_reg noMethods[] = { { NULL, NULL } };
+
+	RegisterInstanceMetatable(L);
+	RegisterPoolMetatable(L);
+	luaL_openlib(L, name, noMethods, 0);
+
+	bindingStats.clear();
+
+	for (const luaL_reg* method = love_fmod_methods; method->name; method++)
+	{
+		BindingStats stats = {};
+		stats.name = method->name;
+		stats.function = method->func;
+		bindingStats.push_back(stats);
+	}
+
+	luaL_unref(L, LUA_REGISTRYINDEX, moduleReference);
+	lua_pushvalue(L, -1);
+	moduleReference = luaL_ref(L, LUA_REGISTRYINDEX);
+
+	RegisterBindings(L);
+}
+
 extern "C" {
 
 	#if !defined( _MSC_VER)
-		__declspec(dllexport) int luaopen_libfmodlove(lua_State* L)
+		FMODLOVE_FFI int luaopen_libfmodlove(lua_State* L)
 	{
-		luaL_openlib(L, "libfmodlove", love_fmod_methods, 0);
+		OpenModule(L, "libfmodlove");
 		return 1;
 	}
 	#else
-		__declspec(dllexport) int luaopen_fmodlove(lua_State* L)
+		FMODLOVE_FFI int luaopen_fmodlove(lua_State* L)
 	{
-		luaL_openlib(L, "fmodlove", love_fmod_methods, 0);
+		OpenModule(L, "fmodlove");
 		return 1;
 	}
 	#endif
@@ -6,6 +6,25 @@ extern "C" {
 #include "fmod_studio.hpp"
 #include "fmod.hpp"
 #include <unordered_map>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <cstdlib>
+#include <cstdio>
+#include <climits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FMODLOVE_SSE2
+#include <emmintrin.h>
+#endif
 
 struct Vector3 {
 
@@ -24,19 +43,650 @@ struct Vector3 {
 	}
 };
 
+// Dense generational slot map used for every object registry exposed to Lua.
+// A handle packs the slot index into the low IndexBits and the slot generation
+// into the remaining bits, so a handle that outlived its object is detected by
+// a generation mismatch instead of silently pointing at a recycled slot.
+// Handles are always positive ints; -1 stays the error value handed to Lua.
+template <typename T>
+class HandleTable
+{
+public:
+	static const unsigned int IndexBits = 20;
+	static const unsigned int IndexMask = (1u << IndexBits) - 1;
+	static const unsigned int GenerationMask = (1u << (31 - IndexBits)) - 1;
+	static const unsigned int NoSlot = 0xFFFFFFFFu;
+
+	int Add(T* object)
+	{
+		unsigned int index;
+
+		if (freeHead != NoSlot)
+		{
+			index = freeHead;
+			freeHead = slots[index].nextFree;
+			if (freeHead == NoSlot)
+			{
+				freeTail = NoSlot;
+			}
+		}
+		else
+		{
+			if (slots.size() > IndexMask)
+			{
+				return -1;
+			}
+
+			index = static_cast<unsigned int>(slots.size());
+			slots.push_back({ nullptr, 1, NoSlot });
+		}
+
+		Slot& slot = slots[index];
+		slot.object = object;
+		slot.nextFree = NoSlot;
+		count++;
+
+		return static_cast<int>((slot.generation << IndexBits) | index);
+	}
+
+	T* Get(unsigned int handle) const
+	{
+		unsigned int index = handle & IndexMask;
+
+		if (index >= slots.size())
+		{
+			return nullptr;
+		}
+
+		const Slot& slot = slots[index];
+
+		if (slot.generation != ((handle >> IndexBits) & GenerationMask))
+		{
+			return nullptr;
+		}
+
+		return slot.object;
+	}
+
+	bool Remove(unsigned int handle)
+	{
+		if (!Get(handle))
+		{
+			return false;
+		}
+
+		unsigned int index = handle & IndexMask;
+		Slot& slot = slots[index];
+
+		slot.object = nullptr;
+		// Generation 0 is never handed out, so handle 0 (what lua_tointeger
+		// returns for nil) can never resolve to a live object.
+		slot.generation = (slot.generation + 1) & GenerationMask;
+		if (slot.generation == 0)
+		{
+			slot.generation = 1;
+		}
+
+		// Freed slots are reused in FIFO order so a single hot slot does not
+		// burn through its generations while the rest of the table sits idle.
+		slot.nextFree = NoSlot;
+		if (freeTail != NoSlot)
+		{
+			slots[freeTail].nextFree = index;
+		}
+		else
+		{
+			freeHead = index;
+		}
+		freeTail = index;
+		count--;
+
+		return true;
+	}
+
+	void Clear()
+	{
+		for (unsigned int i = 0; i < slots.size(); i++)
+		{
+			if (slots[i].object)
+			{
+				Remove((slots[i].generation << IndexBits) | i);
+			}
+		}
+	}
+
+	std::size_t Size() const
+	{
+		return count;
+	}
+
+private:
+	struct Slot
+	{
+		T* object;
+		unsigned int generation;
+		unsigned int nextFree;
+	};
+
+	std::vector<Slot> slots;
+	unsigned int freeHead = NoSlot;
+	unsigned int freeTail = NoSlot;
+	std::size_t count = 0;
+};
+
+// Fixed size single producer, single consumer queue. One thread may Push and
+// one other thread may Pop without locking; Capacity must be a power of two.
+template<typename T, unsigned int Capacity>
+class SpscRing
+{
+public:
+	static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+	bool Push(const T& item)
+	{
+		unsigned int tail = this->tail.load(std::memory_order_relaxed);
+
+		if (tail - head.load(std::memory_order_acquire) == Capacity)
+		{
+			return false;
+		}
+
+		items[tail & (Capacity - 1)] = item;
+		this->tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool Pop(T& item)
+	{
+		unsigned int head = this->head.load(std::memory_order_relaxed);
+
+		if (head == tail.load(std::memory_order_acquire))
+		{
+			return false;
+		}
+
+		item = items[head & (Capacity - 1)];
+		this->head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	T items[Capacity];
+	std::atomic<unsigned int> head{ 0 };
+	std::atomic<unsigned int> tail{ 0 };
+};
+
+struct OneShotPolicy;
+
+// Static properties of an event, resolved once and cached by path.
+struct EventInfo {
+	FMOD::Studio::EventDescription* description;
+	OneShotPolicy* policy;
+	bool is3D;
+	bool isOneshot;
+	float minDistance;
+	float maxDistance;
+	int length;
+};
+
+// A read-only mapping of a whole file, used to hand bank files to FMOD with
+// FMOD_STUDIO_LOAD_MEMORY_POINT so their pages come from the OS page cache.
+struct MappedFile {
+	const char* data;
+	std::size_t length;
+	void* mapping;
+};
+
+bool MapFile(const char* path, MappedFile& outFile);
+
+void UnmapFile(MappedFile& file);
+
+// A bank loaded from a mapped file. The mapping has to outlive the bank, so
+// it is only released once the Studio thread has finished unloading it.
+struct MappedBank {
+	FMOD::Studio::Bank* bank;
+	MappedFile file;
+	bool unloading;
+};
+
+// A bank queued by LoadBankAsync, tracked until its metadata (and, if asked
+// for, its sample data) has finished loading.
+struct PendingBankLoad {
+	int bank;
+	std::string path;
+	bool loadSampleData;
+	bool sampleDataRequested;
+};
+
+// Completion record for an async bank load, queued for Lua to collect.
+struct BankLoadEvent {
+	int bank;
+	std::string path;
+	bool loaded;
+	int result;
+};
+
+enum ResidencyState {
+	RESIDENCY_UNLOADED,
+	RESIDENCY_LOADING,
+	RESIDENCY_LOADED,
+	RESIDENCY_ERROR
+};
+
+// Sample data of one event loaded through the residency manager. pins counts
+// retainSampleData calls and instances the live instances seen at the last
+// update; the sample data is only evicted while both are zero. bytes is the
+// size given with the prefetch hint, or else its share of the growth of
+// FMOD's heap while the data was loading.
+struct SampleResidency {
+	FMOD::Studio::EventDescription* description;
+	ResidencyState state;
+	int pins;
+	int instances;
+	long long bytes;
+	bool sizeHinted;
+	double lastUsed;
+};
+
+struct PendingOneShot {
+	FMOD_3D_ATTRIBUTES attributes;
+	int count;
+};
+
+struct RecentOneShot {
+	FMOD_3D_ATTRIBUTES attributes;
+	FMOD::Studio::EventInstance* instance;
+	double startTime;
+	int count;
+	bool dirty;
+};
+
+// Per-event limits for one-shots. With coalescing enabled, playOneShot calls
+// only queue a request and FlushOneShots() plays them from Update(), merging
+// requests that land within radius of each other (or of a one-shot started
+// less than window seconds ago). The rate limit allows at most maxStarts
+// starts per period seconds and is checked before an instance is created.
+struct OneShotPolicy {
+	std::string path;
+	bool coalesce;
+	float radius;
+	double window;
+	bool hasCountParameter;
+	FMOD_STUDIO_PARAMETER_ID countParameter;
+	int maxStarts;
+	double period;
+	std::vector<double> starts;
+	std::size_t nextStart;
+	std::vector<PendingOneShot> pending;
+	std::vector<RecentOneShot> recent;
+};
+
+enum PoolStealMode {
+	POOL_STEAL_OLDEST = 0,
+	POOL_STEAL_FARTHEST = 1
+};
+
+// A fixed set of instances of one event, created up front and restarted on
+// every play instead of creating and releasing an instance per one-shot.
+struct InstancePool {
+	FMOD::Studio::EventDescription* description;
+	bool is3D;
+	PoolStealMode stealMode;
+	bool sampleDataLoaded;
+	std::vector<FMOD::Studio::EventInstance*> instances;
+	std::vector<unsigned long long> startedAt;
+	std::vector<FMOD_VECTOR> positions;
+	unsigned long long playCount;
+};
+
+enum MemoryMode {
+	MEMORY_SYSTEM = 0,
+	MEMORY_POOL = 1,
+	MEMORY_ARENA = 2
+};
+
+// Non-realtime output: the mixer only advances when fmod.update is called,
+// one DSP block per call, and writes to a wav file or nowhere.
+enum OfflineMode {
+	OFFLINE_NONE = 0,
+	OFFLINE_WAV = 1,
+	OFFLINE_NOSOUND = 2
+};
+
+// Optional settings for Init, read from the options table of fmod.init.
+// Zero (or a negative vol0VirtualVol) leaves FMOD's default in place.
+struct InitOptions {
+	MemoryMode memoryMode = MEMORY_SYSTEM;
+	unsigned int arenaSize = 32 * 1024 * 1024;
+	unsigned int dspBufferLength = 0;
+	int dspBufferCount = 0;
+	int sampleRate = 0;
+	FMOD_SPEAKERMODE speakerMode = FMOD_SPEAKERMODE_DEFAULT;
+	unsigned int streamBufferMs = 0;
+	unsigned int decodeBufferMs = 0;
+	float vol0VirtualVol = -1.f;
+	int maxVorbisCodecs = 0;
+	int maxFADPCMCodecs = 0;
+	OfflineMode offlineMode = OFFLINE_NONE;
+	std::string outputFile;
+};
+
+// Running digest of the master output in offline mode. hash is FNV-1a over
+// the output quantized to 16 bit, as it would be written to a wav file.
+struct OfflineCapture {
+	FMOD::DSP* dsp;
+	std::uint64_t hash;
+	unsigned long long frames;
+	int channels;
+	double clock;
+	double blockSeconds;
+};
+
+// The mixer configuration FMOD ended up with, for fmod.getLatencyInfo.
+struct LatencyInfo {
+	unsigned int dspBufferLength;
+	int dspBufferCount;
+	int sampleRate;
+	FMOD_SPEAKERMODE speakerMode;
+	unsigned int streamBufferSize;
+	FMOD_TIMEUNIT streamBufferUnit;
+	double blockMs;
+	double latencyMs;
+};
+
+// Allocation counters for one size class of the pool allocator. Blocks
+// include the allocation header.
+struct PoolSizeClassStats {
+	std::size_t blockSize;
+	long long inUse;
+	long long peakInUse;
+	long long allocations;
+	long long chunks;
+};
+
+struct MemoryStats {
+	MemoryMode mode;
+	long long currentBytes;
+	long long peakBytes;
+	long long reservedBytes;
+	long long failedAllocations;
+	long long largeAllocations;
+	std::vector<PoolSizeClassStats> sizeClasses;
+};
+
+enum DeferredField {
+	DEFERRED_INSTANCE_VOLUME,
+	DEFERRED_INSTANCE_PITCH,
+	DEFERRED_INSTANCE_PAUSED,
+	DEFERRED_INSTANCE_TIMELINE_POSITION,
+	DEFERRED_INSTANCE_3D_ATTRIBUTES,
+	DEFERRED_INSTANCE_PARAMETER,
+	DEFERRED_GLOBAL_PARAMETER,
+	DEFERRED_BUS_VOLUME,
+	DEFERRED_VCA_VOLUME
+};
+
+// A setter call recorded in deferred mode. target is the EventInstance, Bus or
+// VCA (null for global parameters), parameter the packed parameter ID, flag the
+// paused state or ignoreSeekSpeed, and attributes an index into the deferred
+// 3D attribute array.
+struct DeferredCommand {
+	void* target;
+	std::uint64_t parameter;
+	DeferredField field;
+	bool flag;
+	float value;
+	unsigned int attributes;
+};
+
+enum MeterTargetType {
+	METER_INSTANCE,
+	METER_BUS
+};
+
+// A registered metering target. slot is the meter's position in the dense
+// level arrays and dsp the head DSP metering was last enabled on.
+struct Meter {
+	MeterTargetType type;
+	void* target;
+	FMOD::DSP* dsp;
+	unsigned int slot;
+	unsigned int handle;
+};
+
+// An FFT DSP attached to an instance or bus channel group. bandEdges holds the
+// first FFT bin of each log-spaced band plus one past the last, bandLevels the
+// linear band magnitudes and bands their dB values as of the last update.
+struct SpectrumTap {
+	MeterTargetType type;
+	void* target;
+	FMOD::ChannelGroup* group;
+	FMOD::DSP* dsp;
+	int windowSize;
+	std::vector<int> bandEdges;
+	std::vector<float> bandLevels;
+	std::vector<float> bands;
+};
+
+// Event callback types that can be forwarded to Lua.
+const FMOD_STUDIO_EVENT_CALLBACK_TYPE EventCallbackMask = FMOD_STUDIO_EVENT_CALLBACK_STARTED |
+	FMOD_STUDIO_EVENT_CALLBACK_STOPPED | FMOD_STUDIO_EVENT_CALLBACK_TIMELINE_MARKER |
+	FMOD_STUDIO_EVENT_CALLBACK_TIMELINE_BEAT | FMOD_STUDIO_EVENT_CALLBACK_VIRTUAL_TO_REAL |
+	FMOD_STUDIO_EVENT_CALLBACK_REAL_TO_VIRTUAL;
+
+const int EventCallbackNameLength = 32;
+
+// One event callback as recorded on FMOD's thread. tag is the value given when
+// the callback was set, dspClock the master channel group's DSP clock at the
+// time of the callback. position is the marker or beat position in
+// milliseconds; bar, beat and tempo are only set for beats and name only for
+// markers, truncated to fit.
+struct EventCallbackRecord {
+	int tag;
+	FMOD_STUDIO_EVENT_CALLBACK_TYPE type;
+	int position;
+	int bar;
+	int beat;
+	float tempo;
+	unsigned long long dspClock;
+	char name[EventCallbackNameLength];
+};
+
+// Path and GUID lookups for an interned bus or VCA registry. Both map to the
+// object's handle; ids is keyed by the raw bytes of the FMOD_GUID.
+struct MixerLookup {
+	std::unordered_map<std::string, int> paths;
+	std::unordered_map<std::string, int> ids;
+};
+
+// FMOD_MAX_LISTENERS
+const int MaxListeners = 8;
+
+// Position history of an emitter or listener. Velocity is derived from the
+// last two positions and the real time between them, and positions can be
+// interpolated between those two when the game moves things in fixed ticks.
+struct Motion {
+	FMOD_VECTOR previous;
+	FMOD_VECTOR current;
+	FMOD_VECTOR velocity;
+	double previousTime;
+	double currentTime;
+};
+
+// A listener as last set from Lua, pushed to FMOD from Update().
+struct Listener {
+	FMOD_3D_ATTRIBUTES attributes;
+	Motion motion;
+	bool set;
+	bool dirty;
+	bool moving;
+};
+
+// What happens to an emitter's instance while it is out of range.
+enum EmitterCullMode {
+	EMITTER_CULL_STOP,
+	EMITTER_CULL_PAUSE
+};
+
+// An instance placed in the emitter grid. Only emitters within maxDistance of
+// a listener are kept playing and get their 3D attributes pushed to FMOD.
+// culledPosition and culledAt record where the timeline was when the emitter
+// went out of range, so it can resume where it would have been by now. frame
+// is the last emitter update that found it in range and cell its grid cell.
+// attributes.position is the latest position set; the one sent to FMOD comes
+// from motion.
+struct Emitter {
+	unsigned int instance;
+	FMOD_3D_ATTRIBUTES attributes;
+	Motion motion;
+	bool moving;
+	float maxDistance;
+	EmitterCullMode cullMode;
+	bool audible;
+	bool dirty;
+	int length;
+	bool oneShot;
+	bool finished;
+	int culledPosition;
+	double culledAt;
+	unsigned int frame;
+	int reach;
+	std::uint64_t cell;
+};
+
+// Emitters whose cull distance spans the same number of cells. Each tier has
+// its own grid and range of occupied cells, so emitters with a long reach
+// don't widen the search around the listeners for every other emitter.
+struct EmitterTier {
+	std::unordered_map<std::uint64_t, std::vector<Emitter*>> grid;
+	int cellMin[3];
+	int cellMax[3];
+	int count;
+};
+
+// Setter fields that dirty tracking compares with a tolerance.
+enum DirtyEpsilon {
+	DIRTY_VOLUME,
+	DIRTY_PITCH,
+	DIRTY_PARAMETER,
+	DIRTY_POSITION,
+	DIRTY_VELOCITY,
+	DIRTY_ORIENTATION,
+	DIRTY_EPSILON_COUNT
+};
+
+// Last values written to one instance, bus or VCA (null for global
+// parameters). Bit f of known is set once values[f] holds the last value of
+// DeferredField f, and hasAttributes once attributes holds the last 3D
+// attributes. parameters is keyed by packed parameter ID.
+struct SetterShadow {
+	unsigned int known;
+	float values[DEFERRED_VCA_VOLUME + 1];
+	bool hasAttributes;
+	FMOD_3D_ATTRIBUTES attributes;
+	std::unordered_map<std::uint64_t, float> parameters;
+};
+
+// Timing of one Lua binding, collected while profiling is enabled. Bucket k
+// of the histogram counts calls that took [2^k, 2^(k+1)) nanoseconds.
+const int LatencyBucketCount = 32;
+
+struct BindingStats {
+	const char* name;
+	lua_CFunction function;
+	long long calls;
+	long long totalNanoseconds;
+	long long maxNanoseconds;
+	long long buckets[LatencyBucketCount];
+};
+
 void To3DAttributes(Vector3 position, Vector3 forward, Vector3 up, FMOD_3D_ATTRIBUTES& outAttributes);
 
 void ToFMODVector(Vector3 inVector, FMOD_VECTOR& outVector);
 
+const EventInfo* GetEventInfo(const char* eventPath);
+
+void ClearEventCache();
+
+double GetClockSeconds();
+
+bool SetOneShotCoalescing(const char* eventPath, float radius, float windowMs, const char* countParameterName);
+
+bool SetOneShotRateLimit(const char* eventPath, int maxStarts, float periodMs);
+
+void FlushOneShots(double now);
+
+InstancePool* CreatePool(const char* eventPath, int size, PoolStealMode stealMode);
+
+bool PlayPool(InstancePool* pool, const FMOD_3D_ATTRIBUTES& attributes);
+
+int GetPoolActiveCount(InstancePool* pool);
+
+bool StopPool(InstancePool* pool, int stopMode);
+
+void ReleasePool(InstancePool* pool);
+
 bool Init(const unsigned int& outputType, const unsigned int& realChannels, const unsigned int& virtualChannels,
-	const unsigned int& studioInitFlags);
+	const unsigned int& studioInitFlags, const InitOptions& options = InitOptions());
+
+bool InitializeMemory(const InitOptions& options);
+
+void GetMemoryStats(MemoryStats& outStats);
+
+bool GetLatencyInfo(LatencyInfo& outInfo);
+
+bool IsOffline();
+
+const OfflineCapture& GetOfflineCapture();
+
+void ResetOfflineCapture();
 
 bool Update();
 
-int LoadBank(const char* bankPath, int flags);
+void SetDeferredMode(bool enabled);
+
+void FlushDeferredCommands();
+
+void SetDirtyTracking(bool enabled);
+
+void SetDirtyEpsilon(DirtyEpsilon field, float epsilon);
+
+bool SetEventCallback(FMOD::Studio::EventInstance* instance, FMOD_STUDIO_EVENT_CALLBACK_TYPE mask, int tag);
+
+void DrainEventCallbacks();
+
+int LoadBank(const char* bankPath, int flags, bool memoryMapped = false);
 
 bool UnloadBank(const unsigned int& index);
 
+int LoadBankAsync(const char* bankPath, int flags, bool loadSampleData, bool memoryMapped = false);
+
+void ReleaseUnloadedBankMappings();
+
+void PollBankLoads();
+
+bool GetBankLoadingState(const unsigned int& index, int& loadingState, int& sampleLoadingState);
+
+bool LoadBankSampleData(const unsigned int& index);
+
+bool UnloadBankSampleData(const unsigned int& index);
+
+float GetBankLoadProgress(const unsigned int& index);
+
+float GetLoadingProgress(int& pending);
+
+void SetSampleBudget(long long bytes);
+
+bool PrefetchSampleData(const char* eventPath, long long bytes = 0);
+
+bool RetainSampleData(const char* eventPath);
+
+bool ReleaseSampleData(const char* eventPath);
+
+const SampleResidency* GetSampleResidency(const char* eventPath);
+
+void UpdateSampleResidency(double now);
+
 bool SetNumListeners(const unsigned int& listeners);
 
 bool SetListener3DPosition(const unsigned int& listener, float posX, float posY, float posZ, float dirX, float dirY, float dirZ, float oX, float oY, float oZ);
@@ -49,8 +699,34 @@ bool StopInstance(const unsigned int& index, int stopMode);
 
 bool ReleaseInstance(const unsigned int& index);
 
+bool SetInstanceAutoRelease(const unsigned int& index, bool enabled);
+
+void ReapStoppedInstances();
+
 bool Set3DAttributes(const unsigned int& index, float posX, float posY, float posZ, float dirX, float dirY, float dirZ, float oX, float oY, float oZ);
 
+int CreateEmitter(const unsigned int& instanceIndex, const FMOD_3D_ATTRIBUTES& attributes, float maxDistance,
+	EmitterCullMode cullMode);
+
+int SetEmitterPositions(const unsigned int* emitterIndices, int count, const float* positions);
+
+bool ReleaseEmitter(const unsigned int& emitterIndex);
+
+bool IsEmitterAudible(const unsigned int& emitterIndex);
+
+void SetEmitterCellSize(float cellSize);
+
+void UpdateEmitters(double now);
+
+void SetMotionSmoothing(float smoothing);
+
+void SetMotionInterpolation(bool enabled);
+
+void UpdateListeners(double now);
+
+int Set3DAttributesBatch(const unsigned int* indices, int count, const float* positions, const float* forwards,
+	const float* ups, const float* velocities);
+
 bool PlayOneShot2D(const char* eventPath);
 
 bool PlayOneShot3D(const char* eventPath, float posX, float posY, float posZ, float dirX, float dirY, float dirZ, float oX, float oY, float oZ);
@@ -69,6 +745,28 @@ int GetTimelinePosition(const unsigned int& index);
 
 bool SetTimelinePosition(const unsigned int& index, const unsigned int& position);
 
+int AddInstanceMeter(FMOD::Studio::EventInstance* instance);
+
+int AddBusMeter(const unsigned int& busIndex);
+
+bool RemoveMeter(const unsigned int& meterIndex);
+
+void UpdateMeters();
+
+void LevelsToDecibels(const float* levels, float* decibels, int count, float offset);
+
+int GetMeterLevels(const unsigned int* meterIndices, float* levels, int count);
+
+int AddInstanceSpectrum(FMOD::Studio::EventInstance* instance, int windowSize, int bandCount);
+
+int AddBusSpectrum(const unsigned int& busIndex, int windowSize, int bandCount);
+
+bool RemoveSpectrum(const unsigned int& spectrumIndex);
+
+void UpdateSpectrums();
+
+int GetSpectrum(const unsigned int& spectrumIndex, float* bands, int count);
+
 float GetInstanceRMS(const unsigned int& index);
 
 float GetGlobalParameterByName(const char* parameterName);
@@ -79,7 +777,120 @@ float GetParameterByName(const unsigned int& index, const char* parameterName);
 
 bool SetParameterByName(const unsigned int& index, const char* parameterName, float value, bool ignoreSeekSpeed);
 
+int GetParameterID(const char* eventPath, const char* parameterName);
+
+int GetInstanceParameterID(const unsigned int& index, const char* parameterName);
+
+int GetGlobalParameterID(const char* parameterName);
+
+float GetParameterByID(const unsigned int& index, const unsigned int& parameterId);
+
+bool SetParameterByID(const unsigned int& index, const unsigned int& parameterId, float value, bool ignoreSeekSpeed);
+
+bool SetParametersByIDs(const unsigned int& index, const unsigned int* parameterIds, float* values, int count, bool ignoreSeekSpeed);
+
+float GetGlobalParameterByID(const unsigned int& parameterId);
+
+bool SetGlobalParameterByID(const unsigned int& parameterId, float value, bool ignoreSeekSpeed);
+
+bool SetGlobalParametersByIDs(const unsigned int* parameterIds, float* values, int count, bool ignoreSeekSpeed);
+
 int GetBus(const char* busPath);
 
 float GetBusVolume(const unsigned int& index);
 
+bool SetBusVolume(const unsigned int& index, float volume);
+
+int GetBusVolumes(const unsigned int* indices, float* volumes, int count);
+
+int SetBusVolumes(const unsigned int* indices, const float* volumes, int count);
+
+int GetVCA(const char* vcaPath);
+
+float GetVCAVolume(const unsigned int& index);
+
+bool SetVCAVolume(const unsigned int& index, float volume);
+
+// Plain C entry points for LuaJIT's FFI (see fmod.lua). They take values
+// instead of references and skip the Lua stack entirely, so JIT compiled
+// traces can call straight into them. The Lua module entry point is exported
+// the same way.
+#if defined(_WIN32)
+#define FMODLOVE_FFI __declspec(dllexport)
+#else
+#define FMODLOVE_FFI __attribute__((visibility("default")))
+#endif
+
+extern "C" {
+	FMODLOVE_FFI bool fmodlove_update(void);
+
+	FMODLOVE_FFI bool fmodlove_set_listener_3d_position(unsigned int listener, float posX, float posY, float posZ, float dirX, float dirY, float dirZ, float oX, float oY, float oZ);
+
+	FMODLOVE_FFI int fmodlove_create_instance(const char* eventPath, bool autoRelease);
+
+	FMODLOVE_FFI bool fmodlove_start_instance(unsigned int index);
+
+	FMODLOVE_FFI bool fmodlove_stop_instance(unsigned int index, int stopMode);
+
+	FMODLOVE_FFI bool fmodlove_release_instance(unsigned int index);
+
+	FMODLOVE_FFI bool fmodlove_set_3d_attributes(unsigned int index, float posX, float posY, float posZ, float dirX, float dirY, float dirZ, float oX, float oY, float oZ);
+
+	FMODLOVE_FFI int fmodlove_set_3d_attributes_batch(const unsigned int* indices, int count, const float* positions, const float* forwards, const float* ups, const float* velocities);
+
+	FMODLOVE_FFI int fmodlove_get_meter_levels(const unsigned int* meters, float* levels, int count);
+
+	FMODLOVE_FFI int fmodlove_get_spectrum(unsigned int spectrum, float* bands, int count);
+
+	FMODLOVE_FFI int fmodlove_set_emitter_positions(const unsigned int* emitters, int count, const float* positions);
+
+	FMODLOVE_FFI bool fmodlove_play_one_shot_2d(const char* eventPath);
+
+	FMODLOVE_FFI bool fmodlove_play_one_shot_3d(const char* eventPath, float posX, float posY, float posZ, float dirX, float dirY, float dirZ, float oX, float oY, float oZ);
+
+	FMODLOVE_FFI bool fmodlove_set_instance_volume(unsigned int index, float volume);
+
+	FMODLOVE_FFI bool fmodlove_is_playing(unsigned int index);
+
+	FMODLOVE_FFI bool fmodlove_set_instance_paused(unsigned int index, bool pause);
+
+	FMODLOVE_FFI bool fmodlove_set_instance_pitch(unsigned int index, float pitch);
+
+	FMODLOVE_FFI float fmodlove_get_instance_pitch(unsigned int index);
+
+	FMODLOVE_FFI int fmodlove_get_timeline_position(unsigned int index);
+
+	FMODLOVE_FFI bool fmodlove_set_timeline_position(unsigned int index, unsigned int position);
+
+	FMODLOVE_FFI float fmodlove_get_global_parameter_by_name(const char* parameterName);
+
+	FMODLOVE_FFI bool fmodlove_set_global_parameter_by_name(const char* parameterName, float value, bool ignoreSeekSpeed);
+
+	FMODLOVE_FFI float fmodlove_get_parameter_by_name(unsigned int index, const char* parameterName);
+
+	FMODLOVE_FFI bool fmodlove_set_parameter_by_name(unsigned int index, const char* parameterName, float value, bool ignoreSeekSpeed);
+
+	FMODLOVE_FFI float fmodlove_get_parameter_by_id(unsigned int index, unsigned int parameterId);
+
+	FMODLOVE_FFI bool fmodlove_set_parameter_by_id(unsigned int index, unsigned int parameterId, float value, bool ignoreSeekSpeed);
+
+	FMODLOVE_FFI bool fmodlove_set_parameters_by_ids(unsigned int index, const unsigned int* parameterIds, float* values, int count, bool ignoreSeekSpeed);
+
+	FMODLOVE_FFI float fmodlove_get_global_parameter_by_id(unsigned int parameterId);
+
+	FMODLOVE_FFI bool fmodlove_set_global_parameter_by_id(unsigned int parameterId, float value, bool ignoreSeekSpeed);
+
+	FMODLOVE_FFI bool fmodlove_set_global_parameters_by_ids(const unsigned int* parameterIds, float* values, int count, bool ignoreSeekSpeed);
+
+	FMODLOVE_FFI float fmodlove_get_bus_volume(unsigned int index);
+
+	FMODLOVE_FFI bool fmodlove_set_bus_volume(unsigned int index, float volume);
+
+	FMODLOVE_FFI int fmodlove_get_bus_volumes(const unsigned int* indices, float* volumes, int count);
+
+	FMODLOVE_FFI int fmodlove_set_bus_volumes(const unsigned int* indices, const float* volumes, int count);
+
+	FMODLOVE_FFI float fmodlove_get_vca_volume(unsigned int index);
+
+	FMODLOVE_FFI bool fmodlove_set_vca_volume(unsigned int index, float volume);
+}